@@ -0,0 +1,83 @@
+#include "concurrentpool.hpp"
+#include "../linkedList/linkedlist.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <cstdlib>
+#include <memory>
+
+
+// Every thread keeps LIVE objects and replaces a random one OPS times.
+
+const size_t LIVE = 1024;
+const size_t OPS  = 2000000;
+
+struct Payload{ size_t a, b, c; };
+
+template<class Alloc, class Free>
+double run(size_t threads, Alloc alloc, Free free)
+{
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; ++t)
+        workers.emplace_back([&, t](){
+            std::mt19937 rnd(t);
+            auto state = alloc.make();
+            std::vector<decltype(alloc(state))> live;
+            for (size_t i = 0; i < LIVE; ++i)
+                live.push_back(alloc(state));
+            for (size_t i = 0; i < OPS; ++i){
+                size_t j = rnd() % LIVE;
+                free(state, live[j]);
+                live[j] = alloc(state);
+            }
+            for (auto elem : live)
+                free(state, elem);
+        });
+    for (auto &worker : workers)
+        worker.join();
+    double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return threads * OPS / time / 1e6;
+}
+
+struct MallocAlloc{
+    int make() { return 0; }
+    Payload* operator()(int) { return static_cast<Payload*>(std::malloc(sizeof(Payload))); }
+};
+
+template<class Pool>
+struct CachedAlloc{
+    Pool &pool;
+    std::unique_ptr<typename Pool::Cache> make() { return std::make_unique<typename Pool::Cache>(pool); }
+    uint32_t operator()(std::unique_ptr<typename Pool::Cache> &cache) { return cache->alloc(); }
+};
+
+struct LockedAlloc{
+    ObjPool<Payload> &pool;
+    std::mutex &lock;
+    int make() { return 0; }
+    size_t operator()(int) { std::lock_guard<std::mutex> guard(lock); return pool.alloc(); }
+};
+
+int main()
+{
+    std::cout << "M alloc+free pairs per second\n";
+    std::cout << "threads\tmalloc\tObjPool+mutex\tConcurrentObjPool\n";
+    for (size_t threads = 1; threads <= 64; threads *= 2){
+        double m = run(threads, MallocAlloc{}, [](int, Payload *p){ std::free(p); });
+
+        ObjPool<Payload> single;
+        std::mutex lock;
+        double s = run(threads, LockedAlloc{single, lock},
+                       [&](int, size_t id){ std::lock_guard<std::mutex> guard(lock); single.free(id); });
+
+        ConcurrentObjPool<Payload> shared;
+        double c = run(threads, CachedAlloc<ConcurrentObjPool<Payload>>{shared},
+                       [](auto &cache, uint32_t id){ cache->free(id); });
+
+        std::cout << threads << '\t' << m << '\t' << s << '\t' << c << '\n';
+    }
+}
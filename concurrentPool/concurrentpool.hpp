@@ -0,0 +1,206 @@
+#ifndef CONCURRENTPOOL_HPP
+#define CONCURRENTPOOL_HPP
+
+#include <iostream>
+#include <cassert>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <bit>
+
+
+//==========================================
+// Thread-safe object pool
+//
+// Same id-based interface as ObjPool. Slab k holds BASE << k nodes and is never moved
+// or freed before the pool, so get() is safe from any thread. Free ids go to a
+// lock-free stack whose head packs a 32-bit id with a 32-bit tag bumped on every
+// update (no ABA); fresh ids are bump-allocated. Each thread is expected to work
+// through its own Cache, a magazine of ids that touches the shared stack only to
+// refill or flush half of itself at a time.
+
+template<typename Data, size_t BASE_BITS = 10>
+class ConcurrentObjPool{
+public:
+    static constexpr uint32_t NIL = -1;
+
+    ConcurrentObjPool() : head(pack(0, NIL)), bump(0)
+    {
+        for (auto &slab : slabs)
+            slab.store(nullptr, std::memory_order_relaxed);
+    }
+    ConcurrentObjPool(const ConcurrentObjPool &other) = delete;
+    ConcurrentObjPool& operator=(const ConcurrentObjPool &other) = delete;
+
+    ~ConcurrentObjPool()
+    {
+        for (auto &slab : slabs)
+            delete [] slab.load(std::memory_order_relaxed);
+    }
+
+    uint32_t alloc()
+    {
+        uint32_t id = pop();
+        if (id != NIL)
+            return id;
+        return fresh(1);
+    }
+
+    void free(uint32_t id)
+    {
+        push_chain(id, id);
+    }
+
+    Data *get(uint32_t id) const
+    {
+        assert(id != NIL);
+        assert(id < bump.load(std::memory_order_relaxed));
+        return &node(id).val;
+    }
+
+    uint32_t capacity() const { return bump.load(std::memory_order_relaxed); }   // ids handed out so far
+
+    //==================================
+    // Per-thread magazine
+
+    class Cache{
+    public:
+        static constexpr size_t SIZE = 64;
+
+        Cache(ConcurrentObjPool &pool) : pool(pool), count(0) {}
+        Cache(const Cache &other) = delete;
+        Cache& operator=(const Cache &other) = delete;
+        ~Cache()
+        {
+            flush(count);
+        }
+
+        uint32_t alloc()
+        {
+            if (!count)
+                refill();
+            return ids[--count];
+        }
+
+        void free(uint32_t id)
+        {
+            if (count == SIZE)
+                flush(SIZE / 2);
+            ids[count++] = id;
+        }
+
+        Data *get(uint32_t id) const { return pool.get(id); }
+
+    private:
+        ConcurrentObjPool &pool;
+        size_t   count;
+        uint32_t ids[SIZE];
+
+        void refill()
+        {
+            count = pool.pop_run(ids, SIZE / 2);            // up to half a magazine in one CAS
+            if (count)
+                return;
+            uint32_t first = pool.fresh(SIZE / 2);          // one fetch_add for half a magazine of new ids
+            for (uint32_t i = 0; i < SIZE / 2; ++i)
+                ids[count++] = first + i;
+        }
+
+        void flush(size_t n)
+        {
+            if (!n)
+                return;
+            size_t from = count - n;
+            for (size_t i = from; i + 1 < count; ++i)
+                pool.node(ids[i]).next.store(ids[i + 1], std::memory_order_relaxed);
+            pool.push_chain(ids[from], ids[count - 1]);     // the whole chain in one CAS
+            count = from;
+        }
+    };
+
+
+private:
+    struct Node{
+        std::atomic<uint32_t> next;
+        Data val;
+    };
+
+    static constexpr size_t BASE = size_t(1) << BASE_BITS;
+    static constexpr size_t MAX_SLABS = 32 - BASE_BITS;   // enough for every 32-bit id
+
+    std::atomic<Node*>    slabs[MAX_SLABS];
+    std::atomic<uint64_t> head;                             // tag << 32 | id of the top of the free stack
+    std::atomic<uint32_t> bump;                             // ids below it have been handed out at least once
+    std::mutex            grow;
+
+    static uint64_t pack(uint64_t tag, uint32_t id) { return (tag << 32) | id; }
+
+    // slab k covers ids [BASE * (2^k - 1), BASE * (2^(k + 1) - 1))
+    static size_t slab_of(size_t id)   { return std::bit_width(id / BASE + 1) - 1; }
+    static size_t slab_first(size_t k) { return BASE * ((size_t(1) << k) - 1); }
+
+    Node& node(uint32_t id) const
+    {
+        size_t k = slab_of(id);
+        return slabs[k].load(std::memory_order_acquire)[id - slab_first(k)];
+    }
+
+    uint32_t pop()
+    {
+        uint64_t h = head.load(std::memory_order_acquire);
+        while (true)
+        {
+            uint32_t id = static_cast<uint32_t>(h);
+            if (id == NIL)
+                return NIL;
+            uint32_t next = node(id).next.load(std::memory_order_relaxed);     // may be stale, then the tag check fails
+            if (head.compare_exchange_weak(h, pack((h >> 32) + 1, next), std::memory_order_acq_rel, std::memory_order_acquire))
+                return id;
+        }
+    }
+
+    // Detaches up to n ids from the top of the stack in one CAS. The walk may read stale
+    // links, but then the head has moved on and the tagged CAS fails.
+    size_t pop_run(uint32_t *out, size_t n)
+    {
+        uint64_t h = head.load(std::memory_order_acquire);
+        while (true)
+        {
+            size_t k = 0;
+            uint32_t id = static_cast<uint32_t>(h);
+            for (; k < n && id != NIL; ++k)
+            {
+                out[k] = id;
+                id = node(id).next.load(std::memory_order_relaxed);
+            }
+            if (!k)
+                return 0;
+            if (head.compare_exchange_weak(h, pack((h >> 32) + 1, id), std::memory_order_acq_rel, std::memory_order_acquire))
+                return k;
+        }
+    }
+
+    void push_chain(uint32_t first, uint32_t last)
+    {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        do
+            node(last).next.store(static_cast<uint32_t>(h), std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(h, pack((h >> 32) + 1, first), std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    uint32_t fresh(uint32_t n)
+    {
+        uint32_t first = bump.fetch_add(n, std::memory_order_relaxed);
+        assert(uint64_t(first) + n < NIL);
+        for (size_t k = slab_of(first); k <= slab_of(first + n - 1); ++k)
+            if (!slabs[k].load(std::memory_order_acquire))
+            {
+                std::lock_guard<std::mutex> lock(grow);
+                if (!slabs[k].load(std::memory_order_relaxed))
+                    slabs[k].store(new Node[BASE << k], std::memory_order_release);
+            }
+        return first;
+    }
+};
+
+#endif
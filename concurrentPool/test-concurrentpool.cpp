@@ -0,0 +1,76 @@
+#include "concurrentpool.hpp"
+
+#include <random>
+#include <vector>
+#include <thread>
+#include <set>
+#include "gtest/gtest.h"
+
+
+TEST(Basics, SingleThread)
+{
+    ConcurrentObjPool<size_t, 2> P1;
+    std::set<uint32_t> live;
+    std::mt19937 rnd(179);
+    for (int i = 0; i < 20000; ++i){
+        if (live.empty() || rnd() % 3){
+            uint32_t id = P1.alloc();
+            EXPECT_TRUE(live.insert(id).second);
+            *P1.get(id) = id;
+        }
+        else {
+            auto iter = live.begin();
+            std::advance(iter, rnd() % live.size());
+            EXPECT_EQ(*P1.get(*iter), *iter);
+            P1.free(*iter);
+            live.erase(iter);
+        }
+    }
+}
+
+TEST(Basics, ManyThreads)
+{
+    ConcurrentObjPool<size_t, 4> P1;
+    const size_t THREADS = 8;
+    std::vector<std::vector<uint32_t>> kept(THREADS);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREADS; ++t)
+        threads.emplace_back([&, t](){
+            std::mt19937 rnd(t);
+            ConcurrentObjPool<size_t, 4>::Cache cache(P1);
+            std::vector<uint32_t> live;
+            for (int i = 0; i < 100000; ++i){
+                if (live.empty() || rnd() % 2){
+                    uint32_t id = rnd() % 2 ? cache.alloc() : P1.alloc();
+                    *P1.get(id) = t;                    // a second owner of the id would overwrite it
+                    live.push_back(id);
+                }
+                else {
+                    size_t j = rnd() % live.size();
+                    EXPECT_EQ(*cache.get(live[j]), t);
+                    if (rnd() % 2)
+                        cache.free(live[j]);
+                    else
+                        P1.free(live[j]);
+                    live[j] = live.back();
+                    live.pop_back();
+                }
+            }
+            kept[t] = live;
+        });
+    for (auto &thread : threads)
+        thread.join();
+
+    std::set<uint32_t> all;
+    for (size_t t = 0; t < THREADS; ++t)
+        for (uint32_t id : kept[t]){
+            EXPECT_EQ(*P1.get(id), t);
+            EXPECT_TRUE(all.insert(id).second);
+        }
+}
+
+
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
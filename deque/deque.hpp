@@ -4,6 +4,9 @@
 #include <iostream>
 #include <cassert>
 #include <algorithm>
+#include <utility>
+#include <atomic>
+#include <type_traits>
 
 
 #ifndef NDEBUG                              //WARNING: debug features will fail with types smaller than int
@@ -54,11 +57,16 @@ template<typename T>
 class deque{
 private:
     T* data;                    
+    std::atomic<size_t> *refs_; // number of deques sharing data (copy-on-write), nullptr while there is no buffer
     size_t capacity_;           // Capacity is a number power of two - 1; thus pos & capacity_ == pos % capacity_ <=> it takes into account overflow of a tip of deque
     size_t begin_;              // id of a first element (can be smaller than end_)
     size_t end_;                // id of the last element
     size_t size_;               // independent counter of size of deque
 
+    bool shared() const { return refs_ && refs_->load(std::memory_order_acquire) > 1; }
+    void detach();                                          //takes a private copy of the live range before a write
+    void release();                                         //drops this deque's reference to data
+
 public:
 
     //===========================================
@@ -68,7 +76,7 @@ public:
     deque( const deque &other );
     deque( deque &&other );
 
-    ~deque() { delete[] data; }
+    ~deque() { release(); }
 
     void push_back( const T& val );
     T    pop_back();
@@ -91,11 +99,24 @@ public:
     T erase( size_t pos );
 
 
-          T& operator[]( size_t pos )       { return data[(pos + begin_) & capacity_]; }              
+          T& operator[]( size_t pos )       { detach(); return data[(pos + begin_) & capacity_]; }              
     const T& operator[]( size_t pos ) const { return data[(pos + begin_) & capacity_]; }  
 
+          T& front()       { assert(size_); detach(); return data[begin_]; }
+    const T& front() const { assert(size_); return data[begin_]; }
+          T& back()        { assert(size_); detach(); return data[end_]; }
+    const T& back()  const { assert(size_); return data[end_]; }
+
     size_t size() const { return size_; }
 
+    void clear();                                           //keeps the buffer for further pushes
+
+    void rotate( size_t k );                                //moves k elements from the front to the back
+    void reverse();
+    void swap_ranges( size_t first, size_t second, size_t count );     //ranges [first, first + count) and [second, second + count) must not overlap
+    void truncate_front( size_t n );                        //drops n elements, O(1) for trivially destructible T
+    void truncate_back( size_t n );
+
 
     #ifndef NDEBUG
     //===========================================
@@ -127,6 +148,8 @@ public:
     }
 
     health_error HealthCheck() {
+        if (!data)
+            return size_ ? health_error::size : health_error::none;
         if (size_ > capacity_ + 1)
             return health_error::size;
 
@@ -269,8 +292,8 @@ public:
         
     };
 
-    Iterator begin() { return Iterator( begin_, 0, this); }
-    Iterator end()   { return Iterator( end_ + 1, size(), this); }
+    Iterator begin() { detach(); return Iterator( begin_, 0, this); }
+    Iterator end()   { detach(); return Iterator( end_ + 1, size(), this); }
     
     Iterator begin() const { return Iterator( begin_, 0, this); }
     Iterator end()   const { return Iterator( end_ + 1, size(), this); }
@@ -282,12 +305,10 @@ public:
 
 template<typename T>
 deque<T>::deque( const deque &other ) 
-    : data(nullptr), capacity_(other.capacity_), begin_(other.begin_), end_(other.end_), size_(other.size_) {
+    : data(other.data), refs_(other.refs_), capacity_(other.capacity_), begin_(other.begin_), end_(other.end_), size_(other.size_) {
 
-    if (capacity_){
-        data = new T[capacity_ + 1]; 
-        std::copy(other.data, other.data + capacity_ + 1, data);
-    }
+    if (refs_)
+        refs_->fetch_add(1, std::memory_order_relaxed);         // the buffer is copied on the first write of either side
 
     DEQUE_CHECK(*this)
 }
@@ -295,9 +316,10 @@ deque<T>::deque( const deque &other )
 
 template<typename T>
 deque<T>::deque( deque &&other )
-    : capacity_(other.capacity_), data(other.data), begin_(other.begin_), end_(other.end_), size_(other.size_) {
+    : data(other.data), refs_(other.refs_), capacity_(other.capacity_), begin_(other.begin_), end_(other.end_), size_(other.size_) {
 
     other.data = nullptr;
+    other.refs_ = nullptr;
     other.capacity_ = 0;
     other.begin_    = 0;
     other.end_      = 0;
@@ -309,7 +331,7 @@ deque<T>::deque( deque &&other )
 
 template<typename T>
 deque<T>::deque( size_t size)
-    : data(nullptr), capacity_(0), begin_(0), end_(0), size_(0) {
+    : data(nullptr), refs_(nullptr), capacity_(0), begin_(0), end_(0), size_(0) {
 
     if (!size)
         return;
@@ -318,6 +340,7 @@ deque<T>::deque( size_t size)
         i <<= 1;
     capacity_ = i - 1;
     data = new T[capacity_ + 1];
+    refs_ = new std::atomic<size_t>(1);
 
     #ifndef NDEBUG
     for (size_t j = 0; j <= capacity_; ++j)
@@ -332,7 +355,9 @@ deque<T>::deque( size_t size)
 template<typename T>
 void deque<T>::push_back(const T &val) {
     refit(); 
+    detach();
     if (!size_){
+        begin_ = end_ = 0;                  // pops may have left the tips anywhere in the ring
         data[0] = val;
     }
     else {
@@ -348,6 +373,7 @@ void deque<T>::push_back(const T &val) {
 template<typename T>
 T deque<T>::pop_back() {
     assert(size_);
+    detach();
     --size_;
     size_t return_pos = end_;
     end_ = (end_ - 1) & capacity_;
@@ -368,7 +394,9 @@ T deque<T>::pop_back() {
 template<typename T>
 void deque<T>::push_front(const T &val) {
     refit(); 
+    detach();
     if (!size_){
+        begin_ = end_ = 0;                  // pops may have left the tips anywhere in the ring
         data[0] = val;
     }
     else {
@@ -385,6 +413,7 @@ void deque<T>::push_front(const T &val) {
 template<typename T>
 T deque<T>::pop_front() {
     assert(size_);
+    detach();
     --size_;
     size_t return_pos = begin_;
     begin_ = (begin_ + 1) & capacity_;
@@ -414,17 +443,18 @@ void deque<T>::insert(size_t pos, const T& value) {
         fillPoison(&new_data[k]);
     #endif
 
-    std::copy(begin(), begin() + pos, new_data);
+    const deque &src = *this;                   // reading through const iterators never detaches
+    std::copy(src.begin(), src.begin() + pos, new_data);
     new_data[pos] = value;
-    std::copy(begin() + pos, end(), new_data + pos + 1);
+    std::copy(src.begin() + pos, src.end(), new_data + pos + 1);
 
     begin_ = 0;
     end_ = size_;
     ++size_;
     capacity_ = new_capacity;
-    if (data)
-        delete[] data;
+    release();
     data = new_data;
+    refs_ = new std::atomic<size_t>(1);
 
     DEQUE_CHECK(*this)
 }
@@ -439,22 +469,55 @@ T deque<T>::erase(size_t pos) {
         fillPoison(&new_data[k]);
     #endif
 
-    std::copy(begin(), begin() + pos, new_data);
-    std::copy(begin() + pos + 1, end(), new_data + pos);
+    const deque &src = *this;
+    std::copy(src.begin(), src.begin() + pos, new_data);
+    std::copy(src.begin() + pos + 1, src.end(), new_data + pos);
 
     begin_ = 0;
     end_ = size_ - 2;
     --size_;
 
-    if (data)
-        delete[] data;
+    release();
     data = new_data;
+    refs_ = new std::atomic<size_t>(1);
 
     DEQUE_CHECK(*this)
     return result;
 }
 
 
+template<typename T>
+void deque<T>::detach() {
+    if (!shared())
+        return;
+
+    T* new_data = new T[capacity_ + 1];
+
+    #ifndef NDEBUG
+    for (size_t k = 0; k <= capacity_; ++k)
+        fillPoison(&new_data[k]);
+    #endif
+
+    const deque &src = *this;
+    std::copy(src.begin(), src.end(), new_data);      // only the live range, dead slots stay behind
+    begin_ = 0;
+    end_ = size_ ? size_ - 1 : 0;
+
+    release();
+    data = new_data;
+    refs_ = new std::atomic<size_t>(1);
+}
+
+
+template<typename T>
+void deque<T>::release() {
+    if (refs_ && refs_->fetch_sub(1, std::memory_order_acq_rel) == 1){
+        delete[] data;
+        delete refs_;
+    }
+}
+
+
 template<typename T>
 void deque<T>::refit(size_t new_capacity) {
     if (new_capacity == -1 && ((size_ == capacity_ + 1) || capacity_ == 0))
@@ -479,12 +542,13 @@ void deque<T>::refit(size_t new_capacity) {
         fillPoison(&new_data[k]);
     #endif
 
+    const deque &src = *this;
     if (new_capacity < size_){
-        std::copy(begin(), begin() + (new_capacity + 1), new_data);
+        std::copy(src.begin(), src.begin() + (new_capacity + 1), new_data);
         size_ = new_capacity + 1;
     }
     else 
-        std::copy(begin(), end(), new_data);     
+        std::copy(src.begin(), src.end(), new_data);     
     
     begin_ = 0;
     if (size_)
@@ -492,8 +556,9 @@ void deque<T>::refit(size_t new_capacity) {
     else
         end_ = 0;
     capacity_ = new_capacity;
-    delete[] data;
+    release();
     data = new_data;
+    refs_ = new std::atomic<size_t>(1);
  
 
 
@@ -502,6 +567,146 @@ void deque<T>::refit(size_t new_capacity) {
 }
 
 
+template<typename T>
+void deque<T>::clear() {
+    if (shared()){
+        release();                                          // nothing to copy, the next push allocates a private buffer
+        data = nullptr;
+        refs_ = nullptr;
+        capacity_ = 0;
+        begin_ = 0;
+        end_   = 0;
+        size_  = 0;
+        DEQUE_CHECK(*this)
+        return;                                             // the slots belong to the other owners, no poisoning
+    }
+
+    #ifndef NDEBUG
+    for (size_t i = 0; i < size_; ++i)
+        fillPoison(&data[(begin_ + i) & capacity_]);
+    #endif
+
+    begin_ = 0;
+    end_   = 0;
+    size_  = 0;
+
+    DEQUE_CHECK(*this)
+}
+
+
+template<typename T>
+void deque<T>::rotate(size_t k) {
+    if (!size_)
+        return;
+    k %= size_;
+    if (!k)
+        return;
+    detach();
+
+    if (size_ == capacity_ + 1){
+        begin_ = (begin_ + k) & capacity_;                  // the ring is full: only the tips move
+        end_   = (end_   + k) & capacity_;
+    }
+    else if (k <= size_ - k)
+        for (size_t i = 0; i < k; ++i){
+            end_ = (end_ + 1) & capacity_;
+            data[end_] = data[begin_];
+            #ifndef NDEBUG
+            fillPoison(&data[begin_]);
+            #endif
+            begin_ = (begin_ + 1) & capacity_;
+        }
+    else
+        for (size_t i = 0; i < size_ - k; ++i){
+            begin_ = (begin_ - 1) & capacity_;
+            data[begin_] = data[end_];
+            #ifndef NDEBUG
+            fillPoison(&data[end_]);
+            #endif
+            end_ = (end_ - 1) & capacity_;
+        }
+
+    DEQUE_CHECK(*this)
+}
+
+
+template<typename T>
+void deque<T>::reverse() {
+    detach();
+    for (size_t l = begin_, r = end_, i = 0; i < size_ / 2; ++i){
+        std::swap(data[l], data[r]);
+        l = (l + 1) & capacity_;
+        r = (r - 1) & capacity_;
+    }
+
+    DEQUE_CHECK(*this)
+}
+
+
+template<typename T>
+void deque<T>::swap_ranges(size_t first, size_t second, size_t count) {
+    assert(first + count <= size_ && second + count <= size_);
+    assert(first + count <= second || second + count <= first);
+    detach();
+    for (size_t i = 0; i < count; ++i)
+        std::swap(data[(begin_ + first + i) & capacity_], data[(begin_ + second + i) & capacity_]);
+
+    DEQUE_CHECK(*this)
+}
+
+
+template<typename T>
+void deque<T>::truncate_front(size_t n) {
+    assert(n <= size_);
+    if (!n)
+        return;
+    detach();
+
+    #ifndef NDEBUG
+    for (size_t i = 0; i < n; ++i)
+        fillPoison(&data[(begin_ + i) & capacity_]);
+    #else
+    if constexpr (!std::is_trivially_destructible_v<T>)
+        for (size_t i = 0; i < n; ++i)
+            data[(begin_ + i) & capacity_] = T();           // release what the dropped elements own
+    #endif
+
+    size_ -= n;
+    if (size_)
+        begin_ = (begin_ + n) & capacity_;
+    else
+        begin_ = end_ = 0;
+
+    DEQUE_CHECK(*this)
+}
+
+
+template<typename T>
+void deque<T>::truncate_back(size_t n) {
+    assert(n <= size_);
+    if (!n)
+        return;
+    detach();
+
+    #ifndef NDEBUG
+    for (size_t i = 0; i < n; ++i)
+        fillPoison(&data[(end_ - i) & capacity_]);
+    #else
+    if constexpr (!std::is_trivially_destructible_v<T>)
+        for (size_t i = 0; i < n; ++i)
+            data[(end_ - i) & capacity_] = T();
+    #endif
+
+    size_ -= n;
+    if (size_)
+        end_ = (end_ - n) & capacity_;
+    else
+        begin_ = end_ = 0;
+
+    DEQUE_CHECK(*this)
+}
+
+
 template<typename T>
 bool deque<T>::operator==( const deque &other ) const {
     if (size_ != other.size_)
@@ -527,14 +732,15 @@ bool deque<T>::operator==( const U &other ) const {
 
 template<typename T>
 deque<T>& deque<T>::operator=(const deque &other){
+    if (other.refs_)
+        other.refs_->fetch_add(1, std::memory_order_relaxed);
+    release();
+    data = other.data;
+    refs_ = other.refs_;
     capacity_ = other.capacity_;
     begin_ = other.begin_;
     end_ = other.end_;
     size_ = other.size_;
-    if (data)
-        delete[] data;
-    data = new T[capacity_ + 1];
-    std::copy(other.data, other.data + capacity_ + 1, data);
 
     DEQUE_CHECK(*this)
 
@@ -544,6 +750,8 @@ deque<T>& deque<T>::operator=(const deque &other){
 
 template<typename T>
 deque<T>& deque<T>::operator=(deque &&other){
+    release();
+    refs_     = std::exchange(other.refs_, nullptr);
     capacity_ = std::exchange(other.capacity_, 0);
     begin_    = std::exchange(other.begin_,    0);
     end_      = std::exchange(other.end_,      0);
@@ -0,0 +1,155 @@
+#ifndef SPILLDEQUE_HPP
+#define SPILLDEQUE_HPP
+
+#include <cstdio>
+#include <stdexcept>
+#include <type_traits>
+
+#include "deque.hpp"
+
+
+//==========================================
+// Bounded-memory FIFO deque
+//
+// Elements live in three consecutive parts: head_ (popped from), the spill file and
+// tail_ (pushed to). When tail_ outgrows its budget its oldest block_ elements are
+// appended to the file in one write; when head_ drops below a block the next block
+// is read back ahead of the consumer. Spilled elements are contiguous in the file,
+// so two offsets describe them; the file is rewound once it has been read through.
+
+template<typename T>
+class spillDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "spillDeque writes elements to a file byte by byte");
+
+private:
+    deque<T> head_;
+    deque<T> tail_;
+
+    size_t head_budget_;        // elements kept in memory at each end
+    size_t tail_budget_;
+    size_t block_;              // elements per file write/read
+
+    std::FILE *file_;
+    size_t read_pos_;           // in elements
+    size_t write_pos_;
+    T*     staging_;            // one block, the deque ring is not contiguous
+
+    size_t spilled_bytes_;
+    size_t restored_bytes_;
+
+    void spill();
+    void restore();
+
+public:
+
+    //===========================================
+    // Interface functions
+
+    spillDeque( size_t head_budget = 1 << 16, size_t tail_budget = 1 << 16, size_t block = 1 << 14, const char *path = nullptr );
+    spillDeque( const spillDeque &other ) = delete;
+    ~spillDeque();
+
+    spillDeque& operator=( const spillDeque &other ) = delete;
+
+    void push_back( const T &val );
+    T    pop_front();
+
+    const T& front() const { return head_.size() ? head_.front() : tail_.front(); }
+
+    size_t size()         const { return head_.size() + (write_pos_ - read_pos_) + tail_.size(); }
+    size_t spilled_size() const { return write_pos_ - read_pos_; }          // elements currently on disk
+
+    size_t spilled_bytes()  const { return spilled_bytes_; }
+    size_t restored_bytes() const { return restored_bytes_; }
+};
+
+
+template<typename T>
+spillDeque<T>::spillDeque( size_t head_budget, size_t tail_budget, size_t block, const char *path )
+    : head_(head_budget), tail_(tail_budget), head_budget_(head_budget), tail_budget_(tail_budget), block_(block),
+      file_(nullptr), read_pos_(0), write_pos_(0), staging_(nullptr), spilled_bytes_(0), restored_bytes_(0) {
+
+    assert(block_ && block_ <= tail_budget_);
+    assert(2 * block_ <= head_budget_);                 // a restored block has to fit next to what is left
+
+    file_ = path ? std::fopen(path, "w+b") : std::tmpfile();
+    if (!file_)
+        throw std::runtime_error("Failed to open spill file");
+    staging_ = new T[block_];
+}
+
+
+template<typename T>
+spillDeque<T>::~spillDeque() {
+    if (file_)
+        std::fclose(file_);
+    delete[] staging_;
+}
+
+
+template<typename T>
+void spillDeque<T>::spill() {
+    if (read_pos_ == write_pos_ && head_.size() + block_ <= head_budget_){
+        for (size_t i = 0; i < block_; ++i)             // head_ has room, no need to touch the disk
+            head_.push_back(tail_.pop_front());
+        return;
+    }
+
+    for (size_t i = 0; i < block_; ++i)
+        staging_[i] = tail_.pop_front();
+
+    if (std::fseek(file_, static_cast<long>(write_pos_ * sizeof(T)), SEEK_SET) ||
+        std::fwrite(staging_, sizeof(T), block_, file_) != block_)
+        throw std::runtime_error("Failed to write spill file");
+
+    write_pos_ += block_;
+    spilled_bytes_ += block_ * sizeof(T);
+}
+
+
+template<typename T>
+void spillDeque<T>::restore() {
+    size_t n = std::min(block_, write_pos_ - read_pos_);
+
+    if (std::fseek(file_, static_cast<long>(read_pos_ * sizeof(T)), SEEK_SET) ||
+        std::fread(staging_, sizeof(T), n, file_) != n)
+        throw std::runtime_error("Failed to read spill file");
+
+    for (size_t i = 0; i < n; ++i)
+        head_.push_back(staging_[i]);
+
+    read_pos_ += n;
+    restored_bytes_ += n * sizeof(T);
+    if (read_pos_ == write_pos_)
+        read_pos_ = write_pos_ = 0;                     // everything is back in memory, reuse the file from the start
+}
+
+
+template<typename T>
+void spillDeque<T>::push_back( const T &val ) {
+    if (!tail_.size() && read_pos_ == write_pos_ && head_.size() < head_budget_){
+        head_.push_back(val);
+        return;
+    }
+    tail_.push_back(val);
+    if (tail_.size() >= tail_budget_)
+        spill();
+}
+
+
+template<typename T>
+T spillDeque<T>::pop_front() {
+    assert(size());
+    if (!head_.size()){
+        assert(read_pos_ == write_pos_);                // spill() keeps head_ above a block while the file is in use
+        return tail_.pop_front();
+    }
+
+    T result = head_.pop_front();
+    if (head_.size() < block_ && read_pos_ != write_pos_)
+        restore();
+    return result;
+}
+
+
+#endif
@@ -1,4 +1,5 @@
 #include "deque.hpp"
+#include "spilldeque.hpp"
 
 #include <random>
 #include <deque>
@@ -181,7 +182,7 @@ void RandomAccessIteratorTest()
     }
     for (int i = 0; i < 100; ++i){
         int a = rnd() % (D1.size() / 2 - 1) + 1;
-        int b = -(rnd() % (D1.size() / 2 - 1) + 1);
+        int b = -static_cast<int>(rnd() % a);                  // keeps a + b and size - a - b inside the deque
         auto iter = D1.begin();
         iter += a;
         EXPECT_EQ(*(iter + b), D1[a + b]);
@@ -239,6 +240,140 @@ void RefitTest()
 }
 
 
+template<typename T>
+void SpillTest()
+{
+    std::deque<T> STD1;
+    spillDeque<T> D1(64, 32, 16);
+    for (int k = 0; k < 20; ++k){
+        for (int i = 0; i < rnd() % 500; ++i){
+            T a = static_cast<T>(rnd());
+            D1.push_back(a);
+            STD1.push_back(a);
+        }
+        for (int i = 0; i < rnd() % 500 && STD1.size(); ++i){
+            EXPECT_EQ(D1.front(), STD1.front());
+            EXPECT_EQ(D1.pop_front(), STD1.front());
+            STD1.pop_front();
+        }
+        EXPECT_EQ(D1.size(), STD1.size());
+    }
+    while (STD1.size()){
+        EXPECT_EQ(D1.pop_front(), STD1.front());
+        STD1.pop_front();
+    }
+    EXPECT_EQ(D1.size(), 0);
+    EXPECT_EQ(D1.spilled_size(), 0);
+    EXPECT_EQ(D1.spilled_bytes(), D1.restored_bytes());
+}
+
+template<typename T>
+void SnapshotTest()
+{
+    std::deque<T> STD1;
+    deque<T> D1;
+    for (int i = 0; i < rnd() % 3000 + 150; ++i){
+        T a = static_cast<T>(rnd());
+        D1.push_back(a);
+        STD1.push_back(a);
+    }
+    for (int k = 0; k < 10; ++k){
+        deque<T> S1(D1), S2;
+        std::deque<T> SNAP(STD1);
+        S2 = S1;
+        EXPECT_EQ(&std::as_const(S1)[0], &std::as_const(D1)[0]);      // nobody wrote yet, the buffer is shared
+        for (int i = 0; i < rnd() % 100; ++i){
+            T a = static_cast<T>(rnd());
+            if (rnd() % 2){
+                D1.push_front(a);
+                STD1.push_front(a);
+            }
+            else {
+                D1.pop_back();
+                STD1.pop_back();
+            }
+        }
+        if (D1.size()){
+            D1[D1.size() / 2] = static_cast<T>(rnd());
+            STD1[STD1.size() / 2] = D1[D1.size() / 2];
+        }
+        EXPECT_EQ(D1, STD1);
+        EXPECT_EQ(S1, SNAP);
+        EXPECT_EQ(S2, SNAP);
+        S2.pop_front();
+        SNAP.pop_front();
+        EXPECT_EQ(S2, SNAP);
+        EXPECT_NE(S1, S2);
+    }
+
+    deque<T> C1(D1);                                                // clearing either owner leaves the other intact
+    std::deque<T> SNAP(STD1);
+    C1.clear();
+    EXPECT_EQ(C1.size(), 0);
+    EXPECT_EQ(D1, SNAP);
+    C1.push_back(static_cast<T>(1));
+    EXPECT_EQ(D1, SNAP);
+    deque<T> C2(D1);
+    D1.clear();
+    EXPECT_EQ(D1.size(), 0);
+    EXPECT_EQ(C2, SNAP);
+}
+
+template<typename T>
+void RingOperationsTest()
+{
+    std::deque<T> STD1;
+    deque<T> D1;
+    for (int i = 0; i < rnd() % 2000 + 150; ++i){
+        T a = static_cast<T>(rnd());
+        D1.push_back(a);
+        STD1.push_back(a);
+        if (rnd() % 2){
+            D1.push_front(a);
+            STD1.push_front(a);
+        }
+    }
+    for (int k = 0; k < 50; ++k){
+        switch (rnd() % 5){
+        case 0: {
+            size_t r = rnd() % (3 * STD1.size() + 1);
+            D1.rotate(r);
+            if (STD1.size())
+                std::rotate(STD1.begin(), STD1.begin() + r % STD1.size(), STD1.end());
+            break;
+        }
+        case 1:
+            D1.reverse();
+            std::reverse(STD1.begin(), STD1.end());
+            break;
+        case 2: {
+            size_t count = rnd() % (STD1.size() / 2 + 1);
+            size_t second = STD1.size() - count - rnd() % (STD1.size() - 2 * count + 1);
+            size_t first = rnd() % (second - count + 1);
+            D1.swap_ranges(first, second, count);
+            std::swap_ranges(STD1.begin() + first, STD1.begin() + first + count, STD1.begin() + second);
+            break;
+        }
+        case 3: {
+            size_t n = rnd() % (STD1.size() / 4 + 1);
+            D1.truncate_front(n);
+            STD1.erase(STD1.begin(), STD1.begin() + n);
+            break;
+        }
+        default: {
+            size_t n = rnd() % (STD1.size() / 4 + 1);
+            D1.truncate_back(n);
+            STD1.erase(STD1.end() - n, STD1.end());
+            break;
+        }
+        }
+        EXPECT_EQ(D1, STD1);
+        T a = static_cast<T>(rnd());
+        D1.push_back(a);
+        STD1.push_back(a);
+    }
+}
+
 
 TEST(Basics, PushAndPop)
 {
@@ -350,6 +485,38 @@ TEST(Iterators, RandomAccessIterator){
     }
 }
 
+TEST(Modes, Spill){
+    for (int p = 0; p < 20; ++p){
+        SpillTest<int>();
+        SpillTest<unsigned long long>();
+        SpillTest<double>();
+    }
+}
+
+TEST(Modes, CopyOnWrite){
+    for (int p = 0; p < 20; ++p){
+        SnapshotTest<int>();
+        SnapshotTest<unsigned long long>();
+        SnapshotTest<double>();
+    }
+}
+TEST(Basics, RingOperations){
+    deque<int> full(16);                                // a full ring rotates by moving the tips only
+    std::deque<int> STD1;
+    for (int i = 0; i < 16; ++i){
+        full.push_back(i);
+        STD1.push_back(i);
+    }
+    full.rotate(5);
+    std::rotate(STD1.begin(), STD1.begin() + 5, STD1.end());
+    EXPECT_EQ(full, STD1);
+
+    for (int p = 0; p < 50; ++p){
+        RingOperationsTest<int>();
+        RingOperationsTest<long>();
+        RingOperationsTest<double>();
+    }
+}
 
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
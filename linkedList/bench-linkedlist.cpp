@@ -0,0 +1,262 @@
+#include "linkedlist.hpp"
+#include "unrolledlist.hpp"
+#include "skiplist.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <numeric>
+
+
+std::mt19937 rnd(179);
+
+double since( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<class Container>
+double traverse( const Container &c, long long &check )
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < 10; ++rep)
+        for (auto elem : c)
+            check += elem;
+    return since(start);
+}
+
+template<class Container>
+double random_access( Container &c, size_t queries, long long &check )
+{
+    std::mt19937 gen(1);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < queries; ++i)
+        check += c[gen() % c.size()];
+    return since(start);
+}
+
+template<class Container>
+double random_insert_erase( Container &c, size_t ops )
+{
+    std::mt19937 gen(2);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i){
+        c.insert(gen() % (c.size() + 1), static_cast<int>(i));
+        c.erase(gen() % c.size());
+    }
+    return since(start);
+}
+
+void bench_compaction()
+{
+    const size_t n = 1000000;
+
+    // inserting after a random earlier node leaves list order unrelated to pool order
+    linkedList<int> L;
+    std::vector<linkedList<int>::Iterator> nodes;
+    nodes.reserve(n);
+    L.push_back(0);
+    nodes.push_back(L.begin());
+    for (size_t i = 1; i < n; ++i)
+        nodes.push_back(L.insert_after(nodes[rnd() % nodes.size()], static_cast<int>(i)));
+    nodes.clear();
+
+    std::vector<int> V;
+    for (int elem : L)
+        V.push_back(elem);
+    long long check_vector = 0, check_list = 0;
+
+    std::cout << n << " elements, 10 traversals\n";
+    std::cout << "vector:           " << traverse(V, check_vector) << "s\n";
+    std::cout << "scattered list:   " << traverse(L, check_list) << "s\n";
+
+    linkedList<int> D(L);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n / 64 + 1; ++i)
+        D.defrag(64);
+    auto pass = since(start);
+    std::cout << "defrag(64) pass:  " << traverse(D, check_list) << "s  (pass took " << pass << "s)\n";
+
+    start = std::chrono::steady_clock::now();
+    L.compact();
+    auto compaction = since(start);
+    std::cout << "compacted list:   " << traverse(L, check_list) << "s  (compact() took " << compaction << "s)\n";
+
+    std::cout << "checksum diff " << 3 * check_vector - check_list << "\n\n";
+}
+
+void bench_unrolled()
+{
+    for (size_t n : {10000, 100000}){
+        linkedList<int> L;
+        unrolledList<int, 16> U16;
+        unrolledList<int, 64> U64;
+        for (size_t i = 0; i < n; ++i){
+            L.push_back(static_cast<int>(i));
+            U16.push_back(static_cast<int>(i));
+            U64.push_back(static_cast<int>(i));
+        }
+        long long check_1 = 0, check_2 = 0, check_3 = 0;
+        const size_t queries = 20000;
+
+        std::cout << n << " elements, " << queries << " random operator[] / insert+erase pairs\n";
+        std::cout << "linkedList:        [] " << random_access(L, queries, check_1) << "s,  insert+erase " << random_insert_erase(L, queries)
+                  << "s,  10 traversals " << traverse(L, check_1) << "s\n";
+        std::cout << "unrolledList<16>:  [] " << random_access(U16, queries, check_2) << "s,  insert+erase " << random_insert_erase(U16, queries)
+                  << "s,  10 traversals " << traverse(U16, check_2) << "s\n";
+        std::cout << "unrolledList<64>:  [] " << random_access(U64, queries, check_3) << "s,  insert+erase " << random_insert_erase(U64, queries)
+                  << "s,  10 traversals " << traverse(U64, check_3) << "s\n";
+        std::cout << "checksum diff " << (check_1 - check_2) + (check_1 - check_3) << "\n\n";
+    }
+}
+
+void bench_skiplist()
+{
+    for (size_t n : {1000, 100000, 10000000}){
+        linkedList<int> L;
+        skipList<int> S;
+        for (size_t i = 0; i < n; ++i){
+            L.push_back(static_cast<int>(i));
+            S.push_back(static_cast<int>(i));
+        }
+        long long check_1 = 0, check_2 = 0, check_3 = 0;
+        const size_t walks = std::max<size_t>(20, 20000000 / n);     // a walk costs n / 2 links on average
+        const size_t queries = 200000;
+
+        double walk = random_access(L, walks, check_1);
+        random_access(S, walks, check_2);                               // same queries, for the checksum
+        std::cout << n << " elements, ns per operation\n";
+        std::cout << "linkedList:  [] " << walk / walks * 1e9 << ",  insert+erase " << random_insert_erase(L, walks) / walks * 1e9 << '\n';
+        std::cout << "skipList:    [] " << random_access(S, queries, check_3) / queries * 1e9 << ",  insert+erase "
+                  << random_insert_erase(S, queries) / queries * 1e9 << "  (" << S.levels() << " levels)\n";
+        std::cout << "checksum diff " << check_1 - check_2 << "\n\n";
+    }
+}
+
+struct Record{
+    int key;
+    char payload[60];
+
+    bool operator< ( const Record &other ) const { return key < other.key; }
+    bool operator==( const Record &other ) const { return key == other.key; }
+};
+
+template<class T>
+linkedList<T> copy_out( const linkedList<T> &list, void (*process)(std::vector<T>&) )
+{
+    std::vector<T> tmp;
+    tmp.reserve(list.size());
+    for (auto elem : list)
+        tmp.push_back(elem);
+    process(tmp);
+    linkedList<T> result;
+    for (auto &elem : tmp)
+        result.push_back(elem);
+    return result;
+}
+
+template<class T>
+void bench_algorithms( const char *name, size_t n )
+{
+    linkedList<T> L;
+    for (size_t i = 0; i < n; ++i){
+        T elem{};
+        elem.key = static_cast<int>(rnd() % (n / 4));
+        L.push_back(elem);
+    }
+    auto even = [](const T &elem){ return elem.key % 2 == 0; };
+
+    std::cout << n << " " << name << ",  in-pool vs copy to vector and rebuild\n";
+    linkedList<T> A(L);
+    auto start = std::chrono::steady_clock::now();
+    A.sort();
+    double in_pool = since(start);
+    start = std::chrono::steady_clock::now();
+    linkedList<T> B = copy_out<T>(L, [](std::vector<T> &v){ std::stable_sort(v.begin(), v.end()); });
+    std::cout << "sort:       " << in_pool << "s vs " << since(start) << "s\n";
+    A.compact();                                                    // the rebuilt copy is in memory order too
+
+    start = std::chrono::steady_clock::now();
+    A.unique();
+    in_pool = since(start);
+    start = std::chrono::steady_clock::now();
+    B = copy_out<T>(B, [](std::vector<T> &v){ v.erase(std::unique(v.begin(), v.end()), v.end()); });
+    std::cout << "unique:     " << in_pool << "s vs " << since(start) << "s\n";
+
+    start = std::chrono::steady_clock::now();
+    erase_if(A, even);
+    in_pool = since(start);
+    start = std::chrono::steady_clock::now();
+    B = copy_out<T>(B, [](std::vector<T> &v){ std::erase_if(v, [](const T &elem){ return elem.key % 2 == 0; }); });
+    std::cout << "erase_if:   " << in_pool << "s vs " << since(start) << "s\n";
+
+    start = std::chrono::steady_clock::now();
+    A.reverse();
+    in_pool = since(start);
+    start = std::chrono::steady_clock::now();
+    B = copy_out<T>(B, [](std::vector<T> &v){ std::reverse(v.begin(), v.end()); });
+    std::cout << "reverse:    " << in_pool << "s vs " << since(start) << "s  (" << (A == B ? "same" : "DIFFERENT") << " result)\n\n";
+}
+
+template<class T, class F>
+linkedList<T> scattered( size_t n, F make )
+{
+    linkedList<T> L;
+    std::vector<typename linkedList<T>::Iterator> nodes;
+    nodes.reserve(n);
+    L.push_back(make(0));
+    nodes.push_back(L.begin());
+    for (size_t i = 1; i < n; ++i)
+        nodes.push_back(L.insert_after(nodes[rnd() % nodes.size()], make(i)));
+    return L;
+}
+
+void bench_iteration()
+{
+    const size_t n = 1000000;
+    auto strings = scattered<std::string>(n, [](size_t i){ return std::string(40, char('a' + i % 26)); });
+    auto records = scattered<Record>(n, [](size_t i){ Record r{}; r.key = static_cast<int>(i); r.payload[i % 60] = 1; return r; });
+
+    std::cout << n << " scattered elements, one traversal\n";
+    size_t by_value = 0, by_reference = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::string elem : strings)                                 // what operator* returning T used to cost
+        by_value += elem.size();
+    std::cout << "string by value:      " << since(start) << "s\n";
+    start = std::chrono::steady_clock::now();
+    for (const std::string &elem : strings)
+        by_reference += elem.size();
+    std::cout << "string by reference:  " << since(start) << "s  (checksum diff " << by_value - by_reference << ")\n";
+
+    auto work = [](const Record &r){ long long sum = r.key; for (char c : r.payload) sum += c; return sum; };
+    long long check = 0;
+    start = std::chrono::steady_clock::now();
+    for (Record elem : records)
+        check += work(elem);
+    std::cout << "record by value:      " << since(start) << "s\n";
+    for (size_t k : {0, 2, 4, 8, 16}){
+        records.set_prefetch(k);
+        long long sum = 0;
+        start = std::chrono::steady_clock::now();
+        for (const Record &elem : records)
+            sum += work(elem);
+        std::cout << "record by reference, prefetch " << k << ":  " << since(start) << "s  (checksum diff " << check - sum << ")\n";
+    }
+    std::cout << '\n';
+}
+
+int main()
+{
+    bench_compaction();
+    bench_unrolled();
+    bench_skiplist();
+    bench_iteration();
+
+    struct Key{
+        int key;
+        bool operator< ( const Key &other ) const { return key < other.key; }
+        bool operator==( const Key &other ) const { return key == other.key; }
+    };
+    bench_algorithms<Key>("4-byte elements", 1000000);
+    bench_algorithms<Record>("64-byte elements", 1000000);
+}
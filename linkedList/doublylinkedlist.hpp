@@ -0,0 +1,318 @@
+#ifndef DOUBLYLINKEDLIST_HPP
+#define DOUBLYLINKEDLIST_HPP
+
+#include <iterator>
+
+#include "linkedlist.hpp"
+
+
+//==========================================
+// Doubly linked list
+//
+// Nodes live in an ObjPool like those of linkedList and link both ways, so erase and
+// insert at an iterator are O(1) and iteration is bidirectional. With XOR = true a
+// node keeps a single prev ^ next index instead of two: an iterator then carries the
+// previous id to find the next one, and it is invalidated when its neighbours change.
+
+template<typename Index, bool XOR>
+struct doublyLinks {
+    Index prev_;
+    Index next_;
+};
+
+template<typename Index>
+struct doublyLinks<Index, true> {
+    Index link_;                    // prev ^ next, NIL is all ones
+};
+
+template<typename T, typename Index = uint32_t, bool XOR = false>
+class doublyLinkedList {
+public:
+    struct Node : doublyLinks<Index, XOR> {
+        T val_;
+    };
+
+    static constexpr Index NIL = Index(-1);
+
+private:
+    Index head_;
+    Index tail_;
+    size_t size_;
+    ObjPool<Node, Index> pool;
+
+    Index forward ( Index prev, Index id ) const;           // the neighbour of id that is not prev
+    Index backward( Index next, Index id ) const;           // the neighbour of id that is not next
+    void  set_next( Index id, Index old_next, Index next );
+    void  set_prev( Index id, Index old_prev, Index prev );
+    void  unlink( Index prev, Index id, Index next );
+    void  link( Index prev, Index id, Index next );
+
+public:
+    //===================================
+    //  Interface functions
+
+    doublyLinkedList() : head_(NIL), tail_(NIL), size_(0) {}
+    doublyLinkedList( const doublyLinkedList &other ) = default;
+    doublyLinkedList( doublyLinkedList &&other ) : head_(exchange(other.head_, NIL)), tail_(exchange(other.tail_, NIL)), size_(exchange(other.size_, 0)), pool(std::move(other.pool)) {}
+
+    doublyLinkedList& operator=( const doublyLinkedList &other ) = default;
+    doublyLinkedList& operator=( doublyLinkedList &&other ) { head_ = exchange(other.head_, NIL); tail_ = exchange(other.tail_, NIL); size_ = exchange(other.size_, 0); pool = std::move(other.pool); return *this; }
+
+    size_t size() const { return size_; }
+
+    T&       front()       { assert(size_); return pool.get(head_)->val_; }
+    const T& front() const { assert(size_); return pool.get(head_)->val_; }
+    T&       back()        { assert(size_); return pool.get(tail_)->val_; }
+    const T& back()  const { assert(size_); return pool.get(tail_)->val_; }
+
+    template<class Container>
+    bool operator==( const Container &other ) const;
+    template<class Container>
+    bool operator!=( const Container &other ) const { return !(*this == other); }
+
+    void dump(std::ostream &out) const;        //DEBUG
+
+    //===================================
+    //  Iterators
+
+    template<bool Const>
+    class BasicIterator {
+        friend class doublyLinkedList;
+        template<bool> friend class BasicIterator;
+
+        using list_ptr = std::conditional_t<Const, const doublyLinkedList*, doublyLinkedList*>;
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = T;
+        using pointer           = std::conditional_t<Const, const T*, T*>;
+        using reference         = std::conditional_t<Const, const T&, T&>;
+
+        BasicIterator( list_ptr list = nullptr, Index prev = NIL, Index id = NIL ) : list_(list), prev_(prev), id_(id) {};
+        BasicIterator( const BasicIterator &other ) = default;
+        template<bool C = Const, class = std::enable_if_t<C>>
+        BasicIterator( const BasicIterator<false> &other ) : list_(other.list_), prev_(other.prev_), id_(other.id_) {}
+
+        BasicIterator& operator=( const BasicIterator &other ) = default;
+
+        bool operator==( const BasicIterator &other ) const { return id_ == other.id_; }
+        bool operator!=( const BasicIterator &other ) const { return id_ != other.id_; }
+
+        reference operator*()  const { assert(id_ != NIL); return list_->pool.get(id_)->val_; }
+        pointer   operator->() const { assert(id_ != NIL); return &list_->pool.get(id_)->val_; }
+
+        BasicIterator& operator++() {
+            Index next = list_->forward(prev_, id_);
+            prev_ = id_;
+            id_ = next;
+            return *this;
+        }
+
+        BasicIterator& operator--() {
+            Index prev = id_ == NIL && !XOR ? list_->tail_ : prev_;     // end() of a plain list follows the tail
+            prev_ = list_->backward(id_, prev);
+            id_ = prev;
+            return *this;
+        }
+
+        BasicIterator operator++(int) { BasicIterator result(*this); ++(*this); return result; }
+        BasicIterator operator--(int) { BasicIterator result(*this); --(*this); return result; }
+
+        Index id() const { return id_; }                            // pool slot of the node, stable while it lives
+
+
+    private:
+        list_ptr list_;
+        Index prev_;                    // needed by XOR links only, kept in both modes
+        Index id_;
+
+    };
+
+    using Iterator             = BasicIterator<false>;
+    using ConstIterator        = BasicIterator<true>;
+    using ReverseIterator      = std::reverse_iterator<Iterator>;
+    using ConstReverseIterator = std::reverse_iterator<ConstIterator>;
+
+    Iterator      begin()        { return Iterator(this, NIL, head_); }
+    Iterator      end()          { return Iterator(this, tail_, NIL); }
+    ConstIterator begin()  const { return ConstIterator(this, NIL, head_); }
+    ConstIterator end()    const { return ConstIterator(this, tail_, NIL); }
+    ConstIterator cbegin() const { return begin(); }
+    ConstIterator cend()   const { return end(); }
+
+    ReverseIterator      rbegin()       { return ReverseIterator(end()); }
+    ReverseIterator      rend()         { return ReverseIterator(begin()); }
+    ConstReverseIterator rbegin() const { return ConstReverseIterator(end()); }
+    ConstReverseIterator rend()   const { return ConstReverseIterator(begin()); }
+
+    Iterator      at( Index id )       { static_assert(!XOR, "a XOR-linked node does not know its neighbours"); return Iterator(this, NIL, id); }
+    ConstIterator at( Index id ) const { static_assert(!XOR, "a XOR-linked node does not know its neighbours"); return ConstIterator(this, NIL, id); }
+
+    template<class... Args>
+    Iterator emplace( ConstIterator pos, Args&&... args );              // in front of pos
+    Iterator insert ( ConstIterator pos, const T &val ) { return emplace(pos, val); }
+    Iterator erase  ( ConstIterator pos );                              // returns the iterator past the erased node
+    void     splice ( ConstIterator pos, ConstIterator it );            // moves *it in front of pos
+
+    void push_front( const T &val ) { emplace(begin(), val); }
+    void push_back ( const T &val ) { emplace(end(), val); }
+    T    pop_front();
+    T    pop_back();
+
+    void clear();
+
+private:
+    Index before( const ConstIterator &pos ) const;         // id in front of pos, tail_ for end()
+};
+
+template<typename T, typename Index, bool XOR>
+Index doublyLinkedList<T, Index, XOR>::forward(Index prev, Index id) const {
+    if constexpr (XOR)
+        return pool.get(id)->link_ ^ prev;
+    else
+        return pool.get(id)->next_;
+}
+
+template<typename T, typename Index, bool XOR>
+Index doublyLinkedList<T, Index, XOR>::backward(Index next, Index id) const {
+    if constexpr (XOR)
+        return pool.get(id)->link_ ^ next;
+    else
+        return pool.get(id)->prev_;
+}
+
+template<typename T, typename Index, bool XOR>
+Index doublyLinkedList<T, Index, XOR>::before(const ConstIterator &pos) const {
+    if (pos.id_ == NIL)
+        return tail_;
+    if constexpr (XOR)
+        return pos.prev_;
+    else
+        return pool.get(pos.id_)->prev_;
+}
+
+template<typename T, typename Index, bool XOR>
+void doublyLinkedList<T, Index, XOR>::set_next(Index id, Index old_next, Index next) {
+    if (id == NIL)
+        head_ = next;
+    else if constexpr (XOR)
+        pool.get(id)->link_ ^= old_next ^ next;
+    else
+        pool.get(id)->next_ = next;
+}
+
+template<typename T, typename Index, bool XOR>
+void doublyLinkedList<T, Index, XOR>::set_prev(Index id, Index old_prev, Index prev) {
+    if (id == NIL)
+        tail_ = prev;
+    else if constexpr (XOR)
+        pool.get(id)->link_ ^= old_prev ^ prev;
+    else
+        pool.get(id)->prev_ = prev;
+}
+
+template<typename T, typename Index, bool XOR>
+void doublyLinkedList<T, Index, XOR>::unlink(Index prev, Index id, Index next) {
+    set_next(prev, id, next);
+    set_prev(next, id, prev);
+}
+
+template<typename T, typename Index, bool XOR>
+void doublyLinkedList<T, Index, XOR>::link(Index prev, Index id, Index next) {
+    Node *v = pool.get(id);
+    if constexpr (XOR)
+        v->link_ = prev ^ next;
+    else {
+        v->prev_ = prev;
+        v->next_ = next;
+    }
+    set_next(prev, next, id);
+    set_prev(next, prev, id);
+}
+
+template<typename T, typename Index, bool XOR>
+template<class... Args>
+typename doublyLinkedList<T, Index, XOR>::Iterator doublyLinkedList<T, Index, XOR>::emplace(ConstIterator pos, Args&&... args) {
+    Index next = pos.id_;
+    Index prev = before(pos);
+    Index id = pool.alloc(doublyLinks<Index, XOR>{}, T(std::forward<Args>(args)...));
+    link(prev, id, next);
+    ++size_;
+    return Iterator(this, prev, id);
+}
+
+template<typename T, typename Index, bool XOR>
+typename doublyLinkedList<T, Index, XOR>::Iterator doublyLinkedList<T, Index, XOR>::erase(ConstIterator pos) {
+    Index id = pos.id_;
+    assert(id != NIL);
+    Index prev = before(pos);
+    Index next = forward(prev, id);
+    unlink(prev, id, next);
+    pool.free(id);
+    --size_;
+    return Iterator(this, prev, next);
+}
+
+template<typename T, typename Index, bool XOR>
+void doublyLinkedList<T, Index, XOR>::splice(ConstIterator pos, ConstIterator it) {
+    Index id = it.id_;
+    assert(id != NIL);
+    Index prev = before(it);
+    Index next = forward(prev, id);
+    if (pos.id_ == id || pos.id_ == next)
+        return;                                             // already in place
+    unlink(prev, id, next);
+    link(before(pos), id, pos.id_);                         // pos did not follow id, so its links are intact
+}
+
+template<typename T, typename Index, bool XOR>
+T doublyLinkedList<T, Index, XOR>::pop_front() {
+    assert(size_);
+    T result = std::move(front());
+    erase(begin());
+    return result;
+}
+
+template<typename T, typename Index, bool XOR>
+T doublyLinkedList<T, Index, XOR>::pop_back() {
+    assert(size_);
+    T result = std::move(back());
+    erase(--end());
+    return result;
+}
+
+template<typename T, typename Index, bool XOR>
+void doublyLinkedList<T, Index, XOR>::clear() {
+    pool = ObjPool<Node, Index>();
+    head_ = tail_ = NIL;
+    size_ = 0;
+}
+
+template<typename T, typename Index, bool XOR>
+void doublyLinkedList<T, Index, XOR>::dump(std::ostream &out) const {
+    out << "head = " << head_ << ", tail = " << tail_ << '\n';
+    out << "size = " << size_ << '\n';
+    for (const T &elem : *this)
+        out << "( " << elem << " ) ";
+    out << '\n';
+}
+
+template<typename T, typename Index, bool XOR>
+template<class Container>
+bool doublyLinkedList<T, Index, XOR>::operator==(const Container &other) const {
+    if (size() != other.size()){
+        return false;
+    }
+
+    ConstIterator iter_1 = begin();
+    auto iter_2 = other.begin();
+    while (iter_1 != end()) {
+        if (*iter_1 != *iter_2)
+            return false;
+        ++iter_1; ++iter_2;
+    }
+    return true;
+}
+
+#endif
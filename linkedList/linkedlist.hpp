@@ -3,6 +3,15 @@
 
 #include <iostream>
 #include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <memory>
+#include <type_traits>
 
 
 template<class T, class U = T>
@@ -16,85 +25,102 @@ T exchange(T& obj, U&& new_value)
 //==========================================
 // Object pool
 
-template<typename Data>
+template<typename Data, typename Index = uint32_t, size_t SLAB_BITS = 8>
 class ObjPool{
 public:
+    static constexpr Index NIL = Index(-1);
     
-    ObjPool(const ObjPool &other)
+    ObjPool(const ObjPool &other) : slabs(nullptr), slab_count(0), table_size(0), capacity(0), last_free(NIL)
     {
-        capacity = other.capacity;
-        last_free = other.last_free;
-        data = new Node[capacity];
-        std::copy(other.data, other.data + other.capacity, data);
+        copy_from(other);
     }
 
     ObjPool(ObjPool &&other)
     {
+        slabs = exchange(other.slabs, nullptr);
+        slab_count = exchange(other.slab_count, 0);
+        table_size = exchange(other.table_size, 0);
         capacity = exchange(other.capacity, 0);
-        last_free = exchange(other.last_free, -1);
-        data = exchange(other.data, nullptr);
+        last_free = exchange(other.last_free, NIL);
     }
 
     ObjPool& operator=(const ObjPool &other)
     {
-        capacity = other.capacity;
-        last_free = other.last_free;
-        if (data)
-            delete[] data;
-        data = new Node[capacity];
-        std::copy(other.data, other.data + other.capacity, data);
+        if (this == &other)
+            return (*this);
+        clear();
+        copy_from(other);
         return (*this);
     }
 
     ObjPool& operator=(ObjPool &&other)
     {
+        clear();
+        slabs = exchange(other.slabs, nullptr);
+        slab_count = exchange(other.slab_count, 0);
+        table_size = exchange(other.table_size, 0);
         capacity = exchange(other.capacity, 0);
-        last_free = exchange(other.last_free, -1);
-        if (data)
-            delete[] data;
-        data = exchange(other.data, nullptr);
+        last_free = exchange(other.last_free, NIL);
         return (*this);
     }
     
 
-    ObjPool(size_t capacity=1) : capacity(capacity) 
+    ObjPool(size_t capacity=0) : slabs(nullptr), slab_count(0), table_size(0), capacity(0), last_free(NIL)
     {
-        data = new Node [capacity];
-        for (size_t i=0; i<capacity - 1; ++i)
-            data[i].next = i + 1;
-        data[capacity - 1].next = -1;
-        
-        last_free = 0;
+        while (this->capacity < capacity)
+            add_slab();
     }
     ~ObjPool()
     {
-        delete [] data;
+        clear();
     }
     
-    size_t alloc()
+    template<class... Args>
+    Index alloc(Args&&... args)                 // constructs Data from args in the slot
     {
         refit();
-        size_t result = last_free;
-        last_free = data[last_free].next;
+        Index result = last_free;
+        Node &v = node(result);
+        last_free = v.link.next;
+        if constexpr (std::is_constructible_v<Data, Args...>)
+            new (&v.val) Data(std::forward<Args>(args)...);
+        else
+            new (&v.val) Data{std::forward<Args>(args)...};
         return result;
     }
     
-    Data *get(size_t id) const
+    Data *get(Index id) const
     {
-        assert(id != -1);
+        assert(id != NIL);
         assert(id < capacity);
-        return &data[id].val;
+        return &node(id).val;
     }
     
-    void free(size_t id) 
+    void free(Index id) 
     {
-        data[id].next = last_free;
+        Node &v = node(id);
+        v.val.~Data();
+        v.link.next = last_free;
         last_free = id;
     }
     
+    // Frees a chain of live ids in one step. Data has to be a standard-layout struct whose
+    // first member is the Index of the next id in the chain: that member and Link then form
+    // a common initial sequence, so the pool may walk link.next through the slots without
+    // ending the lifetime of their Data.
+    void free_chain(Index first, Index last)
+    {
+        static_assert(std::is_trivially_destructible_v<Data>, "free_chain() does not run destructors");
+        static_assert(std::is_standard_layout_v<Data>, "free_chain() reads the link through a common initial sequence");
+        node(last).link.next = last_free;
+        last_free = first;
+    }
+
+    size_t slots() const { return capacity; }  // allocated slots, free ones included
+
     void print(std::ostream& out)
     {
-        for (size_t id = last_free; id != -1; id = data[id].next)
+        for (Index id = last_free; id != NIL; id = node(id).link.next)
         {
             out << "(" << id << ") -> ";
         }
@@ -103,66 +129,237 @@ public:
     
     
 private:
-    struct Node{
-        size_t next;
+    // A slot holds either the free-list link or a live Data, never both. The link is
+    // a struct of its own so that free_chain() can rely on a common initial sequence.
+    struct Link{
+        Index next;
+    };
+
+    union Node{
+        Link link;
         Data val;
+
+        Node() : link{NIL} {}
+        ~Node() {}
     };
+
+    // Nodes live in fixed-size slabs that never move: growth adds a slab and at most
+    // reallocates the table of slab pointers, so ids and Data* stay valid.
+    static constexpr size_t SLAB = size_t(1) << SLAB_BITS;
+    static constexpr size_t MASK = SLAB - 1;
     
-    Node *data;
+    Node **slabs;
+    size_t slab_count;
+    size_t table_size;
     size_t capacity;
-    size_t last_free;
+    Index last_free;
+
+    Node& node(size_t id) const { return slabs[id >> SLAB_BITS][id & MASK]; }
+
+    std::vector<bool> free_ids() const
+    {
+        std::vector<bool> result(capacity, false);
+        for (Index id = last_free; id != NIL; id = node(id).link.next)
+            result[id] = true;
+        return result;
+    }
+
+    void add_slab()
+    {
+        assert(capacity + SLAB - 1 < size_t(NIL));
+        if (slab_count == table_size)
+        {
+            size_t new_size = table_size ? table_size * 2 : 1;
+            Node **ntable = new Node*[new_size];
+            std::copy(slabs, slabs + slab_count, ntable);
+            delete [] slabs;
+            slabs = ntable;
+            table_size = new_size;
+        }
+        Node *slab = new Node[SLAB];
+        for (size_t i = 0; i < SLAB - 1; ++i)
+            slab[i].link.next = static_cast<Index>(capacity + i + 1);
+        slab[SLAB - 1].link.next = last_free;
+        slabs[slab_count++] = slab;
+        last_free = static_cast<Index>(capacity);
+        capacity += SLAB;
+    }
+
+    void copy_from(const ObjPool &other)
+    {
+        slabs = new Node*[other.table_size];
+        table_size = other.table_size;
+        slab_count = other.slab_count;
+        capacity = other.capacity;
+        last_free = other.last_free;
+        std::vector<bool> is_free = other.free_ids();
+        for (size_t i = 0; i < slab_count; ++i)
+        {
+            slabs[i] = new Node[SLAB];
+            for (size_t j = 0; j < SLAB; ++j)
+                if (is_free[(i << SLAB_BITS) + j])
+                    slabs[i][j].link.next = other.slabs[i][j].link.next;
+                else
+                    new (&slabs[i][j].val) Data(other.slabs[i][j].val);
+        }
+    }
+
+    void clear()
+    {
+        if constexpr (!std::is_trivially_destructible_v<Data>)
+        {
+            std::vector<bool> is_free = free_ids();
+            for (size_t id = 0; id < capacity; ++id)
+                if (!is_free[id])
+                    node(id).val.~Data();
+        }
+        for (size_t i = 0; i < slab_count; ++i)
+            delete [] slabs[i];
+        delete [] slabs;
+        slabs = nullptr;
+        slab_count = table_size = capacity = 0;
+        last_free = NIL;
+    }
     
     void refit()
     {
-        if (last_free != -1)
+        if (last_free != NIL)
             return;
-        Node *nbuf = new Node[capacity * 2];
-        std::copy(data, data + capacity, nbuf);
-        assert(data);
-        delete [] data;
-        data = nbuf;
-        capacity *= 2;
-        for (size_t i = capacity / 2; i < capacity - 1; ++i)
-            data[i].next = i + 1;
-        data[capacity - 1].next = -1;
-        last_free = capacity / 2;
+        add_slab();
     }
 };
 
 //==========================================
 // LinkedList
 
-template<typename T>
+template<typename T, typename Index = uint32_t>
 class linkedList {
 public:
     struct Node{
-        size_t next_;
+        Index next_;                // keep first: clear() hands whole chains to ObjPool::free_chain()
         T val_;
     };
 
+    using pool_type = ObjPool<Node, Index>;
+
+    static constexpr Index NIL = Index(-1);
+
 private:
-    size_t head_;
-    size_t size_;
-    ObjPool<Node> pool;
+    // A defrag() pass walks the list and swaps every node into the lowest occupied slot
+    // it has not filled yet. Moving the node that sits there needs its predecessor, so
+    // prev_of keeps one for every slot while defragmentation is in use.
+    //
+    // The private pool and the defrag state live apart from the list and are allocated on
+    // its first insert, so a list in a shared pool is only the fields below it.
+    struct Owned{
+        pool_type pool;
+        std::vector<Index> prev_of;         // predecessor of the node in a slot (NIL for head_), the slot itself if free; empty when off
+        Index  defrag_prev = NIL;           // last node placed by the current pass, NIL to start from head_
+        size_t defrag_slot = 0;             // slots below it are filled by the current pass
+        size_t defrag_budget = 0;           // defrag() steps after every modifying call, 0 = off
+    };
+
+    Index head_;
+    Index tail_;                    // id of the last node, NIL for an empty list
+    Index size_;                    // every node has a slot, so Index is wide enough
+    Index prefetch_ = 0;            // links between an iterator and the node it prefetches, 0 = off
+    pool_type *pool_;               // &own_->pool, a pool shared with other lists, or nullptr before the first insert
+    std::unique_ptr<Owned> own_;    // nullptr for a shared list
+
+    Owned&     owned();                                     // allocates the private pool on first use
+    pool_type& pool() { return pool_ ? *pool_ : owned().pool; }
+
+    template<class... Args>
+    Index make_node( Index next, Args&&... args );
+
+    bool  tracking() const { return own_ && !own_->prev_of.empty(); }
+    void  set_prev( Index id, Index prev );
+    void  build_prev();
+    void  swap_slots( Index x, Index t );
+    void  restart_defrag() { if (own_){ own_->defrag_prev = NIL; own_->defrag_slot = 0; } }
+    void  auto_defrag()    { if (own_ && own_->defrag_budget) defrag(own_->defrag_budget); }
+    void  forget( Index id ) { if (own_ && own_->defrag_prev == id) restart_defrag(); }    // id left the list
+
+    Index  ahead_of( Index id ) const;
+
+    size_t adopt( linkedList &other, Index &first, Index &last );      // takes other's chain into pool_, returns its length
+    void   link_after( Index pos, Index first, Index last, size_t count );   // pos NIL links at the front
+    Index  unlink_after( Index before );                                // before NIL unlinks head_
+    Index  take_node( linkedList &other, Index before );               // unlinks the node after before from other, returns its id in pool_
+    Index  merge_chains( Index a, Index b );                            // NIL-terminated sorted chains, ties take a first
+    void   relinked() { restart_defrag(); if (tracking()) build_prev(); }
 
 public:
     //===================================
     //  Interface functions
     
-    linkedList() : head_(-1), size_(0) {}
-    linkedList( const linkedList &other ) = default;
-    linkedList( linkedList &&other ) : head_(other.head_), size_(other.size_) { pool = std::move(other.pool); other.head_ = -1; other.size_ = 0; }
+    linkedList() : head_(NIL), tail_(NIL), size_(0), pool_(nullptr) {}
+    explicit linkedList( pool_type &pool ) : head_(NIL), tail_(NIL), size_(0), pool_(&pool) {}        // pool has to outlive the list
+    linkedList( const linkedList &other );          // a copy lives in the same shared pool as other, or in its own copy of it
+    linkedList( linkedList &&other );
+    ~linkedList() { if (shared()) clear(); }
+
+    linkedList& operator=( const linkedList &other );   // keeps the pool of *this
+    linkedList& operator=( linkedList &&other );        // takes the pool of other
 
-    linkedList& operator=( const linkedList &other ) { head_ = other.head_; size_ = other.size_; pool = other.pool; return *this; }
-    linkedList& operator=( linkedList &&other )  { head_ = other.head_; size_ = other.size_; pool = std::move(other.pool); other.head_ = -1; other.size_ = 0; return *this; }
+    bool shared() const { return pool_ && !own_; }
 
 
     void insert( const T &val ) { insert(0, val); };
     void insert( size_t n, const T &val );
     T erase( size_t n = 0 );
 
+    void push_front( const T &val ) { emplace_front(val); }
+    void push_back ( const T &val ) { emplace_back(val); }
+
+    template<class... Args>
+    void emplace_front( Args&&... args );
+    template<class... Args>
+    void emplace_back( Args&&... args );
+
     size_t size() const { return size_; }
 
+    void clear();                                   // O(1) for trivially destructible, standard-layout T; the slots go back to the pool
+
+    //===================================
+    //  Relinking
+    //
+    //  With a shared pool nodes change lists without being copied: whole-list splices
+    //  are O(1), merge() is one pass of relinking. Lists with different pools move the
+    //  values over instead.
+
+    void splice_front( linkedList &other );
+    void splice_back ( linkedList &other );
+    void merge( linkedList &other );                // both sorted by operator<, other ends up empty, stable
+
+    //===================================
+    //  Algorithms
+    //
+    //  Nodes stay in their slots, only next_ links change; removed nodes go back to the pool.
+
+    void sort();                                    // stable bottom-up merge sort by operator<, no allocation
+    void reverse();
+
+    template<class Pred>
+    size_t remove_if( Pred pred );                  // returns the number of erased elements
+    size_t remove( const T &val ) { return remove_if([&val](const T &elem){ return elem == val; }); }
+
+    template<class BinaryPred = std::equal_to<T>>
+    size_t unique( BinaryPred same = BinaryPred() );    // keeps the first of every run of same elements
+
+    //===================================
+    //  Memory layout
+    //
+    //  Both calls relabel nodes and invalidate iterators and references. defrag()
+    //  keeps an Index per slot from its first call until set_defrag_budget(0), in
+    //  exchange a finished pass leaves the same order as compact() without a second pool.
+
+    void compact();                                             // list order becomes pool order, free slots are dropped
+    void defrag( size_t steps );                                // advances the current pass by steps slots, starts a new one at the tail
+    void set_defrag_budget( size_t steps );                     // defrag(steps) after every insert/erase/push, 0 turns it off
+
+    size_t pool_slots() const { return pool_ ? pool_->slots() : 0; }
+
     template<class Container>
     bool operator==( const Container &other ) const;
     template<class Container>
@@ -176,86 +373,654 @@ public:
     //===================================
     //  Iterators
 
-    struct Iterator {
+    //  operator* gives a reference into the pool. With set_prefetch(k) iterators from
+    //  begin() keep a second cursor k links ahead and prefetch its node, so the loads of
+    //  a scattered list overlap with the work done on the current element.
+
+    template<bool Const>
+    class BasicIterator {
+        friend class linkedList;
+        template<bool> friend class BasicIterator;
+
+        using pool_ptr = std::conditional_t<Const, const pool_type*, pool_type*>;
+
+    public:
         using iterator_category = std::forward_iterator_tag;
         using difference_type   = std::ptrdiff_t;
-        using value_type        = Node;
+        using value_type        = T;
+        using pointer           = std::conditional_t<Const, const T*, T*>;
+        using reference         = std::conditional_t<Const, const T&, T&>;
+
+        BasicIterator( Index id = NIL, pool_ptr pool = nullptr, Index ahead = NIL ) : pool_(pool), id_(id), ahead_(ahead) {};
+        BasicIterator( const BasicIterator &other ) = default;
+        template<bool C = Const, class = std::enable_if_t<C>>
+        BasicIterator( const BasicIterator<false> &other ) : pool_(other.pool_), id_(other.id_), ahead_(other.ahead_) {}
 
-        Iterator( size_t id = -1, const ObjPool<Node> *pool = nullptr ) : pool_(pool), id_(id) {};
-        Iterator( const Iterator &other ) = default;
+        BasicIterator& operator=( const BasicIterator &other ) = default;
 
-        bool operator==( const Iterator &other ) const { return id_ == other.id_; }
-        bool operator!=( const Iterator &other ) const { return id_ != other.id_; }
+        bool operator==( const BasicIterator &other ) const { return id_ == other.id_; }
+        bool operator!=( const BasicIterator &other ) const { return id_ != other.id_; }
 
-        T operator*() { assert(id_ != -1); return pool_->get(id_)->val_; }
-        const T operator*() const { assert(id_ != -1); return pool_->get(id_)->val_; }
+        reference operator*()  const { assert(id_ != NIL); return pool_->get(id_)->val_; }
+        pointer   operator->() const { assert(id_ != NIL); return &pool_->get(id_)->val_; }
 
-        Iterator operator++() {
+        BasicIterator& operator++() {
             id_ = pool_->get(id_)->next_;
+            if (ahead_ != NIL){
+                ahead_ = pool_->get(ahead_)->next_;
+#if defined(__GNUC__)
+                if (ahead_ != NIL)
+                    __builtin_prefetch(pool_->get(ahead_));
+#endif
+            }
             return *this;
         }
 
-        Iterator operator++(int) {
-            Iterator result(*this);
-            id_ = pool_->get(id_)->next_;
+        BasicIterator operator++(int) {
+            BasicIterator result(*this);
+            ++(*this);
             return result;
         }
 
 
     private:
-        const ObjPool<Node> *pool_;
-        size_t id_;
+        pool_ptr pool_;
+        Index id_;
+        Index ahead_;                   // prefetch cursor, NIL when prefetching is off
 
     };
 
-    Iterator begin() const { return Iterator(head_, &pool); }
-    Iterator end()   const { return Iterator(   -1, &pool); }
+    using Iterator      = BasicIterator<false>;
+    using ConstIterator = BasicIterator<true>;
+
+    Iterator      begin()        { return Iterator(head_, pool_, ahead_of(head_)); }
+    Iterator      end()          { return Iterator(  NIL, pool_); }
+    ConstIterator begin()  const { return ConstIterator(head_, pool_, ahead_of(head_)); }
+    ConstIterator end()    const { return ConstIterator(  NIL, pool_); }
+    ConstIterator cbegin() const { return begin(); }
+    ConstIterator cend()   const { return end(); }
+
+    void set_prefetch( size_t links ) { prefetch_ = static_cast<Index>(links); }   // 0 turns it off
+
+    Iterator insert_after( ConstIterator pos, const T &val ) { return emplace_after(pos, val); }
+    T        erase_after ( ConstIterator pos );                     // erases the node following pos
+
+    void splice_after( ConstIterator pos, linkedList &other );
+    void splice_after( ConstIterator pos, linkedList &other, ConstIterator before );   // the node after before, other.end() stands for the one before other's head
+    void splice_front( linkedList &other, ConstIterator before );
+
+    template<class... Args>
+    Iterator emplace_after( ConstIterator pos, Args&&... args );
 };
 
-template<typename T>
-void linkedList<T>::insert(size_t n, const T &val) {
-    assert(n <= size_);
+template<typename T, typename Index>
+linkedList<T, Index>::linkedList(const linkedList &other)
+    : head_(other.head_), tail_(other.tail_), size_(other.size_), prefetch_(other.prefetch_), pool_(nullptr) {
+    if (!other.shared()){
+        if (other.own_){
+            own_ = std::make_unique<Owned>(*other.own_);        // ids stay the same, so do head_ and tail_
+            pool_ = &own_->pool;
+        }
+        return;
+    }
+    pool_ = other.pool_;
+    head_ = tail_ = NIL;
+    size_ = 0;
+    for (const T &elem : other)
+        emplace_back(elem);
+}
+
+template<typename T, typename Index>
+linkedList<T, Index>::linkedList(linkedList &&other)
+    : head_(exchange(other.head_, NIL)), tail_(exchange(other.tail_, NIL)), size_(exchange(other.size_, 0)),
+      prefetch_(other.prefetch_), pool_(other.pool_), own_(std::move(other.own_)) {
+    if (own_)
+        other.pool_ = nullptr;                                  // a shared other stays in its pool
+}
+
+template<typename T, typename Index>
+linkedList<T, Index>& linkedList<T, Index>::operator=(const linkedList &other) {
+    if (this == &other)
+        return *this;
+    clear();
+    if (shared() || other.shared()){
+        for (const T &elem : other)
+            emplace_back(elem);
+        return *this;
+    }
+    own_ = other.own_ ? std::make_unique<Owned>(*other.own_) : nullptr;
+    pool_ = own_ ? &own_->pool : nullptr;
+    head_ = other.head_;
+    tail_ = other.tail_;
+    size_ = other.size_;
+    prefetch_ = other.prefetch_;
+    return *this;
+}
+
+template<typename T, typename Index>
+linkedList<T, Index>& linkedList<T, Index>::operator=(linkedList &&other) {
+    if (this == &other)
+        return *this;
+    clear();
+    own_ = std::move(other.own_);
+    pool_ = other.pool_;
+    if (own_)
+        other.pool_ = nullptr;
+    head_ = exchange(other.head_, NIL);
+    tail_ = exchange(other.tail_, NIL);
+    size_ = exchange(other.size_, 0);
+    prefetch_ = other.prefetch_;
+    return *this;
+}
+
+template<typename T, typename Index>
+typename linkedList<T, Index>::Owned& linkedList<T, Index>::owned() {
+    assert(!shared());
+    if (!own_){
+        own_ = std::make_unique<Owned>();
+        pool_ = &own_->pool;
+    }
+    return *own_;
+}
+
+template<typename T, typename Index>
+Index linkedList<T, Index>::ahead_of(Index id) const {
+    if (!prefetch_)
+        return NIL;
+    for (size_t i = 0; i < prefetch_ && id != NIL; ++i)
+        id = pool_->get(id)->next_;
+    return id;
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::clear() {
+    if (head_ != NIL){
+        if constexpr (std::is_trivially_destructible_v<T> && std::is_standard_layout_v<Node>){
+            static_assert(offsetof(Node, next_) == 0, "free_chain() follows next_ as the free-list link");
+            pool_->free_chain(head_, tail_);
+        }
+        else
+            for (Index id = head_; id != NIL; ){
+                Index next = pool_->get(id)->next_;
+                pool_->free(id);
+                id = next;
+            }
+    }
+    head_ = tail_ = NIL;
+    size_ = 0;
+    if (own_)
+        own_->prev_of.clear();                                  // rebuilt by the next defrag()
+    restart_defrag();
+}
+
+template<typename T, typename Index>
+size_t linkedList<T, Index>::adopt(linkedList &other, Index &first, Index &last) {
+    assert(&other != this);
+    size_t count = other.size_;
+    if (other.pool_ == pool_){
+        first = exchange(other.head_, NIL);
+        last = exchange(other.tail_, NIL);
+        other.size_ = 0;
+        return count;
+    }
+    first = last = NIL;
+    for (Index id = other.head_; id != NIL; id = other.pool_->get(id)->next_){
+        Index cur = pool().alloc(NIL, std::move(other.pool_->get(id)->val_));
+        if (first == NIL)
+            first = cur;
+        else
+            pool_->get(last)->next_ = cur;
+        last = cur;
+    }
+    other.clear();
+    return count;
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::link_after(Index pos, Index first, Index last, size_t count) {
+    if (first == NIL)
+        return;
+    Index next = pos == NIL ? head_ : pool_->get(pos)->next_;
+    pool_->get(last)->next_ = next;
+    if (pos == NIL)
+        head_ = first;
+    else
+        pool_->get(pos)->next_ = first;
+    if (next == NIL)
+        tail_ = last;
+    size_ += static_cast<Index>(count);
+
+    if (!tracking())
+        return;
+    for (Index id = first, prev = pos; id != next; prev = id, id = pool_->get(id)->next_)
+        set_prev(id, prev);
+    if (next != NIL)
+        set_prev(next, last);
+}
+
+template<typename T, typename Index>
+Index linkedList<T, Index>::unlink_after(Index before) {
+    Index id = before == NIL ? head_ : pool_->get(before)->next_;
+    assert(id != NIL);
+    Index next = pool_->get(id)->next_;
+    if (before == NIL)
+        head_ = next;
+    else
+        pool_->get(before)->next_ = next;
+    if (tail_ == id)
+        tail_ = before;
+    forget(id);
+    --size_;
+    set_prev(id, id);
+    if (next != NIL)
+        set_prev(next, before);
+    return id;
+}
+
+template<typename T, typename Index>
+Index linkedList<T, Index>::take_node(linkedList &other, Index before) {
+    Index id = other.unlink_after(before);
+    if (other.pool_ == pool_)
+        return id;
+    Index result = pool().alloc(NIL, std::move(other.pool_->get(id)->val_));
+    other.pool_->free(id);
+    return result;
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::splice_front(linkedList &other) {
+    Index first, last;
+    size_t count = adopt(other, first, last);
+    link_after(NIL, first, last, count);
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::splice_back(linkedList &other) {
+    Index first, last;
+    size_t count = adopt(other, first, last);
+    link_after(tail_, first, last, count);
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::splice_after(ConstIterator pos, linkedList &other) {
+    assert(pos.id_ != NIL);
+    Index first, last;
+    size_t count = adopt(other, first, last);
+    link_after(pos.id_, first, last, count);
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::splice_after(ConstIterator pos, linkedList &other, ConstIterator before) {
+    assert(pos.id_ != NIL);
+    Index id = take_node(other, before.id_);
+    link_after(pos.id_, id, id, 1);
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::splice_front(linkedList &other, ConstIterator before) {
+    Index id = take_node(other, before.id_);
+    link_after(NIL, id, id, 1);
+}
+
+template<typename T, typename Index>
+Index linkedList<T, Index>::merge_chains(Index a, Index b) {
+    Index head = NIL, tail = NIL;
+    while (a != NIL && b != NIL){
+        Index &from = pool_->get(b)->val_ < pool_->get(a)->val_ ? b : a;
+        Index id = from;
+        from = pool_->get(id)->next_;
+        if (tail == NIL)
+            head = id;
+        else
+            pool_->get(tail)->next_ = id;
+        tail = id;
+    }
+    Index rest = a != NIL ? a : b;
+    if (tail == NIL)
+        return rest;
+    pool_->get(tail)->next_ = rest;
+    return head;
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::merge(linkedList &other) {
+    Index first, last;
+    size_t count = adopt(other, first, last);
+    if (first == NIL)
+        return;
+    if (tail_ == NIL || !(pool_->get(last)->val_ < pool_->get(tail_)->val_))
+        tail_ = last;                                           // a tie puts other's node last
+    head_ = merge_chains(head_, first);
+    size_ += static_cast<Index>(count);
+    relinked();
+}
+
+// Bucket i holds a sorted chain of 2^i nodes that came before every node of the
+// lower buckets, so merging a bucket with a carry from below keeps the sort stable
+template<typename T, typename Index>
+void linkedList<T, Index>::sort() {
+    if (size_ < 2)
+        return;
+    Index buckets[sizeof(Index) * 8 + 1];
+    size_t used = 0;
+    for (Index id = head_; id != NIL; ){
+        Index carry = id;
+        id = pool_->get(id)->next_;
+        pool_->get(carry)->next_ = NIL;
+        size_t i = 0;
+        for (; i < used && buckets[i] != NIL; ++i){
+            carry = merge_chains(buckets[i], carry);
+            buckets[i] = NIL;
+        }
+        if (i == used)
+            ++used;
+        buckets[i] = carry;
+    }
+
+    Index result = NIL;
+    for (size_t i = 0; i < used; ++i)
+        if (buckets[i] != NIL)
+            result = merge_chains(buckets[i], result);
+    head_ = result;
+    for (tail_ = head_; pool_->get(tail_)->next_ != NIL; tail_ = pool_->get(tail_)->next_);
+    relinked();
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::reverse() {
+    Index prev = NIL;
+    tail_ = head_;
+    for (Index id = head_; id != NIL; ){
+        Index next = pool_->get(id)->next_;
+        pool_->get(id)->next_ = prev;
+        prev = id;
+        id = next;
+    }
+    head_ = prev;
+    relinked();
+}
+
+template<typename T, typename Index>
+template<class Pred>
+size_t linkedList<T, Index>::remove_if(Pred pred) {
+    size_t removed = 0;
+    Index prev = NIL;
+    for (Index id = head_; id != NIL; ){
+        Node *v = pool_->get(id);
+        Index next = v->next_;
+        if (pred(std::as_const(v->val_))){
+            if (prev == NIL)
+                head_ = next;
+            else
+                pool_->get(prev)->next_ = next;
+            pool_->free(id);
+            ++removed;
+        }
+        else
+            prev = id;
+        id = next;
+    }
+    tail_ = prev;
+    size_ -= static_cast<Index>(removed);
+    relinked();
+    return removed;
+}
+
+template<typename T, typename Index>
+template<class BinaryPred>
+size_t linkedList<T, Index>::unique(BinaryPred same) {
+    if (head_ == NIL)
+        return 0;
+    size_t removed = 0;
+    Index id = head_;
+    for (Index next = pool_->get(id)->next_; next != NIL; next = pool_->get(id)->next_){
+        Node *v = pool_->get(id);
+        Node *u = pool_->get(next);
+        if (same(std::as_const(v->val_), std::as_const(u->val_))){
+            v->next_ = u->next_;
+            pool_->free(next);
+            ++removed;
+        }
+        else
+            id = next;
+    }
+    tail_ = id;
+    size_ -= static_cast<Index>(removed);
+    relinked();
+    return removed;
+}
+
+template<typename T, typename Index>
+template<class... Args>
+Index linkedList<T, Index>::make_node(Index next, Args&&... args) {
     ++size_;
-    if (n == 0){
-        size_t id = pool.alloc();
-        pool.get(id)->next_ = head_;
-        pool.get(id)->val_ = val;
+    return pool().alloc(next, T(std::forward<Args>(args)...));
+}
+
+template<typename T, typename Index>
+template<class... Args>
+void linkedList<T, Index>::emplace_front(Args&&... args) {
+    head_ = make_node(head_, std::forward<Args>(args)...);
+    set_prev(head_, NIL);
+    if (tail_ == NIL)
+        tail_ = head_;
+    else
+        set_prev(pool_->get(head_)->next_, head_);
+    auto_defrag();
+}
+
+template<typename T, typename Index>
+template<class... Args>
+void linkedList<T, Index>::emplace_back(Args&&... args) {
+    Index id = make_node(NIL, std::forward<Args>(args)...);
+    set_prev(id, tail_);
+    if (tail_ == NIL)
         head_ = id;
+    else
+        pool_->get(tail_)->next_ = id;
+    tail_ = id;
+    auto_defrag();
+}
+
+template<typename T, typename Index>
+template<class... Args>
+typename linkedList<T, Index>::Iterator linkedList<T, Index>::emplace_after(ConstIterator pos, Args&&... args) {
+    assert(pos.id_ != NIL);
+    Node *v = pool_->get(pos.id_);
+    Index id = make_node(v->next_, std::forward<Args>(args)...);
+    pool_->get(pos.id_)->next_ = id;                              // v may be stale if alloc() grew the pool
+    set_prev(id, pos.id_);
+    if (tail_ == pos.id_)
+        tail_ = id;
+    else
+        set_prev(pool_->get(id)->next_, id);
+    return Iterator(id, pool_);
+}
+
+template<typename T, typename Index>
+T linkedList<T, Index>::erase_after(ConstIterator pos) {
+    assert(pos.id_ != NIL);
+    Node *v = pool_->get(pos.id_);
+    Index id = v->next_;
+    assert(id != NIL);
+    Node *u = pool_->get(id);
+    v->next_ = u->next_;
+    set_prev(id, id);
+    if (tail_ == id)
+        tail_ = pos.id_;
+    else
+        set_prev(v->next_, pos.id_);
+    forget(id);
+    --size_;
+    T result = std::move(u->val_);
+    pool_->free(id);
+    return result;
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::insert(size_t n, const T &val) {
+    assert(n <= size_);
+    if (n == 0){
+        emplace_front(val);
+        return;
+    }
+    if (n == size_){
+        emplace_back(val);
         return;
     }
-    size_t id = head_;
+    Index id = head_;
     for (size_t i = 0; i < n - 1; ++i)
-        id = pool.get(id)->next_;
+        id = pool_->get(id)->next_;
 
-    size_t new_id = pool.alloc();
-    Node *v = pool.get(id), *new_ = pool.get(new_id);
-    new_->next_ = v->next_;
-    new_->val_ = val;
-    v->next_ = new_id;
+    emplace_after(Iterator(id, pool_), val);
+    auto_defrag();
 }
 
-template<typename T>
-T linkedList<T>::erase(size_t n) {
+template<typename T, typename Index>
+T linkedList<T, Index>::erase(size_t n) {
     assert(n < size_);
-    --size_;
     if (n == 0){
-        Node *v = pool.get(head_);
+        Index id = head_;
+        Node *v = pool_->get(id);
         head_ = v->next_;
-        return v->val_;
+        set_prev(id, id);
+        if (tail_ == id)
+            tail_ = NIL;
+        else
+            set_prev(head_, NIL);
+        forget(id);
+        --size_;
+        T result_val = std::move(v->val_);
+        pool_->free(id);
+        auto_defrag();
+        return result_val;
     }
-    size_t id = head_;
+    Index id = head_;
     for (size_t i = 0; i < n - 1; ++i)
-        id = pool.get(id)->next_;
-    Node *v = pool.get(id);
-    size_t result_id = v->next_;
-    v->next_ = pool.get(result_id)->next_;
-    T result_val = pool.get(result_id)->val_;
-    pool.free(result_id);
+        id = pool_->get(id)->next_;
+    T result_val = erase_after(Iterator(id, pool_));
+    auto_defrag();
     return result_val;
 }
 
-template<typename T>
-void linkedList<T>::dump(std::ostream &out) const {
+template<typename T, typename Index>
+void linkedList<T, Index>::compact() {
+    assert(!shared());                                          // ids of a shared pool belong to other lists too
+    ObjPool<Node, Index> packed;                                // an empty pool hands out ids 0, 1, 2, ... in order
+    Index prev = NIL;
+    for (Index id = head_; id != NIL; ){
+        Node *v = pool_->get(id);
+        Index cur = packed.alloc(NIL, std::move(v->val_));
+        if (prev == NIL)
+            head_ = cur;
+        else
+            packed.get(prev)->next_ = cur;
+        prev = cur;
+        id = v->next_;
+    }
+    tail_ = prev;
+    owned().pool = std::move(packed);
+    restart_defrag();
+    if (tracking())
+        build_prev();
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::set_defrag_budget(size_t steps) {
+    assert(!steps || !shared());
+    if (steps){
+        owned().defrag_budget = steps;
+        return;
+    }
+    if (own_){
+        own_->defrag_budget = 0;
+        std::vector<Index>().swap(own_->prev_of);
+        restart_defrag();
+    }
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::defrag(size_t steps) {
+    assert(!shared());
+    if (size_ < 2)
+        return;
+    Owned &o = owned();
+    if (o.prev_of.empty())
+        build_prev();                                           // one traversal, the links are tracked from now on
+
+    for (size_t i = 0; i < steps; ++i){
+        Index id = o.defrag_prev == NIL ? head_ : pool_->get(o.defrag_prev)->next_;
+        if (id == NIL || o.defrag_slot == o.prev_of.size()){
+            restart_defrag();
+            continue;
+        }
+        Index slot = static_cast<Index>(o.defrag_slot++);
+        if (o.prev_of[slot] == slot)                            // free slots are skipped, they still cost a step
+            continue;
+        if (id != slot)
+            swap_slots(id, slot);
+        o.defrag_prev = slot;
+    }
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::set_prev(Index id, Index prev) {
+    if (!tracking())
+        return;
+    std::vector<Index> &prev_of = own_->prev_of;
+    for (size_t i = prev_of.size(); i < pool_->slots(); ++i)
+        prev_of.push_back(static_cast<Index>(i));
+    prev_of[id] = prev;
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::build_prev() {
+    std::vector<Index> &prev_of = owned().prev_of;
+    prev_of.resize(pool().slots());
+    for (size_t i = 0; i < prev_of.size(); ++i)
+        prev_of[i] = static_cast<Index>(i);
+    Index prev = NIL;
+    for (Index id = head_; id != NIL; id = pool_->get(id)->next_){
+        prev_of[id] = prev;
+        prev = id;
+    }
+    restart_defrag();
+}
+
+// Exchanges the nodes in slots x and t (both live), then redirects every link into them
+template<typename T, typename Index>
+void linkedList<T, Index>::swap_slots(Index x, Index t) {
+    auto relabel = [x, t](Index id) { return id == x ? t : id == t ? x : id; };
+
+    std::vector<Index> &prev_of = own_->prev_of;
+    Node *a = pool_->get(x);
+    Node *b = pool_->get(t);
+    Index pa = prev_of[x], pb = prev_of[t];
+    Index na = a->next_,   nb = b->next_;
+
+    using std::swap;
+    swap(a->val_, b->val_);
+    swap(a->next_, b->next_);
+    swap(prev_of[x], prev_of[t]);
+
+    for (Index p : {pa, pb}){                                   // links pointing at x or t
+        if (p == NIL)
+            head_ = relabel(head_);
+        else {
+            Node *v = pool_->get(relabel(p));
+            v->next_ = relabel(v->next_);
+        }
+    }
+    for (Index n : {na, nb})                                    // predecessors that are x or t
+        if (n != NIL)
+            prev_of[relabel(n)] = relabel(prev_of[relabel(n)]);
+
+    tail_ = relabel(tail_);
+    own_->defrag_prev = relabel(own_->defrag_prev);
+}
+
+template<typename T, typename Index>
+void linkedList<T, Index>::dump(std::ostream &out) const {
     out << "head = " << head_ << '\n';
     out << "size = " << size_ << '\n';
     for (auto elem : *this)
@@ -263,14 +1028,14 @@ void linkedList<T>::dump(std::ostream &out) const {
     out << '\n';
 }
 
-template<typename T>
+template<typename T, typename Index>
 template<class Container>
-bool linkedList<T>::operator==(const Container &other) const {
+bool linkedList<T, Index>::operator==(const Container &other) const {
     if (size() != other.size()){
         return false;
     }
 
-    Iterator iter_1 = begin();
+    ConstIterator iter_1 = begin();
     auto iter_2 = other.begin();
     while (iter_1 != end()) {
         if (*iter_1 != *iter_2)
@@ -281,20 +1046,25 @@ bool linkedList<T>::operator==(const Container &other) const {
 }
 
 
-template<typename T>
-T& linkedList<T>::operator[](size_t n) {
-    size_t id = head_;
+template<typename T, typename Index>
+T& linkedList<T, Index>::operator[](size_t n) {
+    Index id = head_;
     for (size_t i = 0; i < n; ++i)
-        id = pool.get(id)->next_;
-    return pool.get(id)->val_;
+        id = pool_->get(id)->next_;
+    return pool_->get(id)->val_;
 }
 
-template<typename T>
-const T& linkedList<T>::operator[](size_t n) const {
-    size_t id = head_;
+template<typename T, typename Index>
+const T& linkedList<T, Index>::operator[](size_t n) const {
+    Index id = head_;
     for (size_t i = 0; i < n; ++i)
-        id = pool.get(id)->next_;
-    return pool.get(id)->val_;
+        id = pool_->get(id)->next_;
+    return pool_->get(id)->val_;
+}
+
+template<typename T, typename Index, class Pred>
+size_t erase_if( linkedList<T, Index> &list, Pred pred ) {
+    return list.remove_if(pred);
 }
 
 #endif
@@ -0,0 +1,292 @@
+#ifndef SKIPLIST_HPP
+#define SKIPLIST_HPP
+
+#include <bit>
+
+#include "linkedlist.hpp"
+
+
+//==========================================
+// Indexable skip list
+//
+// Level 0 is an ordinary singly linked list of elements, so iteration is the same as
+// in linkedList. Every element is promoted to h more levels with P(h) = 3/4 * 4^-h;
+// a level is a list of towers that carry the rank distance (span) to their right
+// neighbour. Ranks count from 1, rank 0 is the head towers in front of the list.
+// operator[], insert(n) and erase(n) go down the spans in expected O(log n).
+
+template<typename T, typename Index = uint32_t>
+class skipList {
+public:
+    struct Node{
+        Index next_;
+        T val_;
+    };
+
+    static constexpr Index  NIL = Index(-1);
+    static constexpr size_t MAX_LEVEL = 16;
+
+private:
+    struct Tower{
+        Index right;
+        Index down;                 // the tower of the same element one level lower, NIL on level 1
+        Index node;                 // element id, NIL for the head towers
+        Index span;                 // rank of right minus own rank, size_ + 1 - own rank when right is NIL
+    };
+
+    Index head_;
+    Index tail_;                    // id of the last node, NIL for an empty list
+    size_t size_;
+    ObjPool<Node, Index> pool;
+    ObjPool<Tower, Index> towers;
+
+    Index    top_;                  // head tower of the highest level, NIL while there are no levels
+    size_t   levels_;
+    uint32_t seed_;                 // xorshift state for tower heights
+
+    size_t random_height();
+    void   add_level();
+    Index  find( size_t rank, Index *update = nullptr, size_t *rank_at = nullptr ) const;     // element of that rank, NIL for 0
+
+public:
+    //===================================
+    //  Interface functions
+
+    skipList() : head_(NIL), tail_(NIL), size_(0), top_(NIL), levels_(0), seed_(179) {}
+    skipList( const skipList &other ) = default;
+    skipList( skipList &&other );
+
+    skipList& operator=( const skipList &other ) = default;
+    skipList& operator=( skipList &&other );
+
+
+    void insert( const T &val ) { insert(0, val); };
+    void insert( size_t n, const T &val );
+    T erase( size_t n = 0 );
+
+    void push_front( const T &val ) { insert(0, val); }
+    void push_back ( const T &val ) { insert(size_, val); }
+
+    size_t size()   const { return size_; }
+    size_t levels() const { return levels_; }
+
+    template<class Container>
+    bool operator==( const Container &other ) const;
+    template<class Container>
+    bool operator!=( const Container &other ) const { return !(*this == other); }
+
+    void dump(std::ostream &out) const;        //DEBUG
+
+    T& operator[](size_t n)             { assert(n < size_); return pool.get(find(n + 1))->val_; }
+    const T& operator[](size_t n) const { assert(n < size_); return pool.get(find(n + 1))->val_; }
+
+    //===================================
+    //  Iterators
+
+    struct Iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = T;
+
+        Iterator( Index id = NIL, const ObjPool<Node, Index> *pool = nullptr ) : pool_(pool), id_(id) {};
+        Iterator( const Iterator &other ) = default;
+
+        bool operator==( const Iterator &other ) const { return id_ == other.id_; }
+        bool operator!=( const Iterator &other ) const { return id_ != other.id_; }
+
+        T operator*() { assert(id_ != NIL); return pool_->get(id_)->val_; }
+        const T operator*() const { assert(id_ != NIL); return pool_->get(id_)->val_; }
+
+        Iterator operator++() {
+            id_ = pool_->get(id_)->next_;
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator result(*this);
+            id_ = pool_->get(id_)->next_;
+            return result;
+        }
+
+
+    private:
+        const ObjPool<Node, Index> *pool_;
+        Index id_;
+
+    };
+
+    Iterator begin() const { return Iterator(head_, &pool); }
+    Iterator end()   const { return Iterator(  NIL, &pool); }
+};
+
+template<typename T, typename Index>
+skipList<T, Index>::skipList(skipList &&other)
+    : head_(other.head_), tail_(other.tail_), size_(other.size_), pool(std::move(other.pool)), towers(std::move(other.towers)),
+      top_(other.top_), levels_(other.levels_), seed_(other.seed_) {
+    other.head_ = other.tail_ = other.top_ = NIL;
+    other.size_ = other.levels_ = 0;
+}
+
+template<typename T, typename Index>
+skipList<T, Index>& skipList<T, Index>::operator=(skipList &&other) {
+    head_ = exchange(other.head_, NIL);
+    tail_ = exchange(other.tail_, NIL);
+    size_ = exchange(other.size_, 0);
+    pool = std::move(other.pool);
+    towers = std::move(other.towers);
+    top_ = exchange(other.top_, NIL);
+    levels_ = exchange(other.levels_, 0);
+    seed_ = other.seed_;
+    return *this;
+}
+
+template<typename T, typename Index>
+size_t skipList<T, Index>::random_height() {
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return std::countr_zero(seed_ | (uint32_t(1) << (2 * MAX_LEVEL - 2))) / 2;      // two fair coins per level
+}
+
+template<typename T, typename Index>
+void skipList<T, Index>::add_level() {
+    assert(levels_ < MAX_LEVEL);
+    top_ = towers.alloc(NIL, top_, NIL, static_cast<Index>(size_ + 1));
+    ++levels_;
+}
+
+// Goes down from the top level keeping left of rank + 1; update[l] and rank_at[l]
+// get the last tower passed on level l + 1 and its rank
+template<typename T, typename Index>
+Index skipList<T, Index>::find(size_t rank, Index *update, size_t *rank_at) const {
+    size_t r = 0;
+    Index cur = top_;
+    Index id = NIL;
+    for (size_t level = levels_; level > 0; --level){
+        const Tower *t = towers.get(cur);
+        while (t->right != NIL && r + t->span <= rank){
+            r += t->span;
+            cur = t->right;
+            t = towers.get(cur);
+        }
+        if (update){
+            update[level - 1] = cur;
+            rank_at[level - 1] = r;
+        }
+        id = t->node;
+        cur = t->down;
+    }
+    for (; r < rank; ++r)
+        id = id == NIL ? head_ : pool.get(id)->next_;
+    return id;
+}
+
+template<typename T, typename Index>
+void skipList<T, Index>::insert(size_t n, const T &val) {
+    assert(n <= size_);
+    assert(size_ + 1 < size_t(NIL));
+    Index  update[MAX_LEVEL];
+    size_t rank_at[MAX_LEVEL];
+    Index prev = find(n, update, rank_at);
+
+    Index next = prev == NIL ? head_ : pool.get(prev)->next_;
+    Index id = pool.alloc(next, val);
+    if (prev == NIL)
+        head_ = id;
+    else
+        pool.get(prev)->next_ = id;
+    if (next == NIL)
+        tail_ = id;
+
+    size_t height = random_height();
+    while (levels_ < height){
+        add_level();
+        update[levels_ - 1] = top_;
+        rank_at[levels_ - 1] = 0;
+    }
+
+    Index down = NIL;
+    for (size_t level = 1; level <= levels_; ++level){
+        Tower *u = towers.get(update[level - 1]);
+        if (level > height){
+            ++u->span;                                          // the new element lands inside this span
+            continue;
+        }
+        down = towers.alloc(u->right, down, id, static_cast<Index>(rank_at[level - 1] + u->span - n));
+        u->right = down;
+        u->span = static_cast<Index>(n + 1 - rank_at[level - 1]);
+    }
+    ++size_;
+}
+
+template<typename T, typename Index>
+T skipList<T, Index>::erase(size_t n) {
+    assert(n < size_);
+    Index  update[MAX_LEVEL];
+    size_t rank_at[MAX_LEVEL];
+    Index prev = find(n, update, rank_at);
+    Index id = prev == NIL ? head_ : pool.get(prev)->next_;
+
+    for (size_t level = 1; level <= levels_; ++level){
+        Tower *u = towers.get(update[level - 1]);
+        Index right = u->right;
+        if (right != NIL && towers.get(right)->node == id){
+            u->span += towers.get(right)->span - 1;
+            u->right = towers.get(right)->right;
+            towers.free(right);
+        }
+        else
+            --u->span;
+    }
+    while (levels_ && towers.get(top_)->right == NIL){          // drop levels left with the head tower only
+        Index below = towers.get(top_)->down;
+        towers.free(top_);
+        top_ = below;
+        --levels_;
+    }
+
+    Node *v = pool.get(id);
+    if (prev == NIL)
+        head_ = v->next_;
+    else
+        pool.get(prev)->next_ = v->next_;
+    if (tail_ == id)
+        tail_ = prev;
+    --size_;
+    T result = std::move(v->val_);
+    pool.free(id);
+    return result;
+}
+
+template<typename T, typename Index>
+void skipList<T, Index>::dump(std::ostream &out) const {
+    out << "head = " << head_ << '\n';
+    out << "size = " << size_ << '\n';
+    for (Index top = top_; top != NIL; top = towers.get(top)->down){
+        for (Index t = top; t != NIL; t = towers.get(t)->right)
+            out << "-" << towers.get(t)->span << "-> ";
+        out << '\n';
+    }
+    for (auto elem : *this)
+        out << "( " << elem << " ) ";
+    out << '\n';
+}
+
+template<typename T, typename Index>
+template<class Container>
+bool skipList<T, Index>::operator==(const Container &other) const {
+    if (size() != other.size()){
+        return false;
+    }
+
+    Iterator iter_1 = begin();
+    auto iter_2 = other.begin();
+    while (iter_1 != end()) {
+        if (*iter_1 != *iter_2)
+            return false;
+        ++iter_1; ++iter_2;
+    }
+    return true;
+}
+
+#endif
@@ -1,5 +1,11 @@
 #include "linkedlist.hpp"
+#include "unrolledlist.hpp"
+#include "skiplist.hpp"
+#include "doublylinkedlist.hpp"
 #include <vector>
+#include <list>
+#include <string>
+#include <algorithm>
 #include <random>
 #include "gtest/gtest.h"
 
@@ -121,6 +127,635 @@ TEST(Basics, copyAndMove){
    }
 }
 
+TEST(Basics, pushBackAndIterators){
+    for (int k = 0; k < 100; ++k){
+        linkedList<int> L1;
+        std::list<int> S1;
+        for (int i = 0; i < rnd() % 1000 + 25; ++i){
+            int a = rnd();
+            if (rnd() % 4){
+                L1.push_back(a);
+                S1.push_back(a);
+            }
+            else {
+                L1.push_front(a);
+                S1.push_front(a);
+            }
+        }
+        EXPECT_EQ(L1, S1);
+
+        for (int j = 0; j < 200; ++j){
+            size_t pos = rnd() % L1.size();
+            auto iter_1 = L1.begin();
+            auto iter_2 = S1.begin();
+            for (size_t i = 0; i < pos; ++i){
+                ++iter_1; ++iter_2;
+            }
+            ++iter_2;
+            if (rnd() % 2 || pos + 1 == L1.size()){
+                int a = rnd();
+                L1.insert_after(iter_1, a);
+                S1.insert(iter_2, a);
+            }
+            else {
+                EXPECT_EQ(L1.erase_after(iter_1), *iter_2);
+                S1.erase(iter_2);
+            }
+        }
+        EXPECT_EQ(L1, S1);
+
+        int a = rnd();                                  // the tail is still right after the edits
+        L1.push_back(a);
+        S1.push_back(a);
+        L1.erase(0);
+        S1.pop_front();
+        EXPECT_EQ(L1, S1);
+    }
+}
+
+TEST(Basics, emplace){
+    linkedList<std::string> L1;
+    std::list<std::string> S1;
+    for (int i = 0; i < 1000; ++i){
+        L1.emplace_back(i % 10 + 1, 'a' + i % 26);
+        S1.emplace_back(i % 10 + 1, 'a' + i % 26);
+        L1.emplace_front(i % 7 + 1, 'z');
+        S1.emplace_front(i % 7 + 1, 'z');
+    }
+    L1.emplace_after(L1.begin(), "after");
+    S1.emplace(++S1.begin(), "after");
+    EXPECT_EQ(L1, S1);
+}
+
+TEST(Pool, stableAddresses){
+    linkedList<int> L1;
+    L1.push_back(179);
+    int *first = &L1[0];
+    for (int i = 0; i < 100000; ++i)
+        L1.push_back(i);
+    EXPECT_EQ(first, &L1[0]);                           // growth adds slabs without moving old nodes
+    EXPECT_EQ(*first, 179);
+}
+
+TEST(Pool, compact){
+    linkedList<int> L1;
+    std::list<int> S1;
+    for (int i = 0; i < 20000; ++i){
+        int a = rnd();
+        L1.push_back(a);
+        S1.push_back(a);
+    }
+    for (int i = 0; i < 5000; ++i){
+        size_t pos = rnd() % L1.size();
+        auto iter = S1.begin();
+        std::advance(iter, pos);
+        if (rnd() % 3){
+            EXPECT_EQ(L1.erase(pos), *iter);
+            S1.erase(iter);
+        }
+        else {
+            int a = rnd();
+            L1.insert(pos, a);
+            S1.insert(iter, a);
+        }
+    }
+    size_t before = L1.pool_slots();
+    L1.compact();
+    EXPECT_EQ(L1, S1);
+    EXPECT_LT(L1.pool_slots(), before);
+    EXPECT_LT(L1.pool_slots(), L1.size() + 256);
+
+    using Node = linkedList<int>::Node;
+    for (size_t i = 0; i + 1 < 256; ++i)                // neighbours in the list are neighbours in the slab
+        EXPECT_EQ(reinterpret_cast<char*>(&L1[i + 1]) - reinterpret_cast<char*>(&L1[i]), sizeof(Node));
+
+    L1.push_back(179);
+    S1.push_back(179);
+    L1.erase(0);
+    S1.pop_front();
+    EXPECT_EQ(L1, S1);
+
+    linkedList<int> L2;
+    L2.compact();
+    EXPECT_EQ(L2.size(), 0);
+    EXPECT_EQ(L2.pool_slots(), 0);
+}
+
+TEST(Pool, incrementalDefrag){
+    for (size_t budget : {2, 7, 64}){
+        linkedList<std::string> L1;
+        std::list<std::string> S1;
+        L1.set_defrag_budget(budget);
+        for (int i = 0; i < 3000; ++i){
+            std::string a = std::to_string(rnd() % 1000);
+            size_t pos = S1.size() ? rnd() % (S1.size() + 1) : 0;
+            auto iter = S1.begin();
+            std::advance(iter, pos);
+            switch (rnd() % 5){
+            case 0:
+                L1.push_back(a);
+                S1.push_back(a);
+                break;
+            case 1:
+                L1.push_front(a);
+                S1.push_front(a);
+                break;
+            case 2:
+                if (pos < S1.size()){
+                    EXPECT_EQ(L1.erase(pos), *iter);
+                    S1.erase(iter);
+                }
+                break;
+            default:
+                L1.insert(pos, a);
+                S1.insert(iter, a);
+            }
+        }
+        EXPECT_EQ(L1, S1);
+        L1.push_back("tail");                           // the tail survives relocation
+        S1.push_back("tail");
+        EXPECT_EQ(L1, S1);
+    }
+
+    linkedList<int> L2;                                 // no free slots: a full pass matches compact()
+    std::vector<linkedList<int>::Iterator> nodes;
+    std::list<int> S2;
+    L2.push_back(0);
+    nodes.push_back(L2.begin());
+    for (int i = 1; i < 5000; ++i)
+        nodes.push_back(L2.insert_after(nodes[rnd() % nodes.size()], i));
+    for (int elem : L2)
+        S2.push_back(elem);
+    nodes.clear();
+
+    L2.defrag(L2.size() + 1);
+    EXPECT_EQ(L2, S2);
+    using Node = linkedList<int>::Node;
+    for (size_t i = 0; i + 1 < 256; ++i)
+        EXPECT_EQ(reinterpret_cast<char*>(&L2[i + 1]) - reinterpret_cast<char*>(&L2[i]), sizeof(Node));
+}
+
+TEST(Unrolled, randomInsertErase){
+    for (int k = 0; k < 100; ++k){
+        unrolledList<int, 8> L1;
+        std::vector<int> V1;
+        for (int i = 0; i < 2000; ++i){
+            int a = rnd();
+            size_t pos = rnd() % (V1.size() + 1);
+            if (V1.size() && rnd() % 3 == 0){
+                pos = rnd() % V1.size();
+                EXPECT_EQ(L1.erase(pos), V1[pos]);
+                V1.erase(V1.begin() + pos);
+            }
+            else if (rnd() % 4 == 0){
+                L1.push_front(a);
+                V1.insert(V1.begin(), a);
+            }
+            else if (rnd() % 4 == 0){
+                L1.push_back(a);
+                V1.push_back(a);
+            }
+            else {
+                L1.insert(pos, a);
+                V1.insert(V1.begin() + pos, a);
+            }
+        }
+        ASSERT_EQ(L1, V1);
+        for (size_t i = 0; i < V1.size(); ++i)
+            EXPECT_EQ(L1[i], V1[i]);
+        EXPECT_LE(L1.blocks(), V1.size() / 2 + 2);      // blocks do not degrade into single elements
+
+        while (V1.size()){
+            EXPECT_EQ(L1.erase(0), V1.front());
+            V1.erase(V1.begin());
+        }
+        EXPECT_EQ(L1.size(), 0);
+        EXPECT_EQ(L1.blocks(), 0);
+    }
+}
+
+TEST(Unrolled, copyAndMove){
+    unrolledList<std::string, 4> L1;
+    std::list<std::string> S1;
+    for (int i = 0; i < 500; ++i){
+        L1.push_back(std::to_string(i));
+        S1.push_back(std::to_string(i));
+    }
+    unrolledList<std::string, 4> L2(L1);
+    L1[0] = "changed";
+    EXPECT_EQ(L2, S1);
+    EXPECT_NE(L1, S1);
+
+    unrolledList<std::string, 4> L3(std::move(L2));
+    EXPECT_EQ(L3, S1);
+    EXPECT_EQ(L2.size(), 0);
+    L2 = L3;
+    L3 = std::move(L1);
+    EXPECT_EQ(L2, S1);
+    EXPECT_EQ(L3[0], "changed");
+    L2.insert(250, "middle");
+    S1.insert(std::next(S1.begin(), 250), "middle");
+    EXPECT_EQ(L2, S1);
+}
+
+TEST(SkipList, randomInsertErase){
+    for (int k = 0; k < 50; ++k){
+        skipList<int> L1;
+        std::vector<int> V1;
+        for (int i = 0; i < 3000; ++i){
+            int a = rnd();
+            if (V1.size() && rnd() % 3 == 0){
+                size_t pos = rnd() % V1.size();
+                EXPECT_EQ(L1.erase(pos), V1[pos]);
+                V1.erase(V1.begin() + pos);
+            }
+            else {
+                size_t pos = rnd() % (V1.size() + 1);
+                L1.insert(pos, a);
+                V1.insert(V1.begin() + pos, a);
+            }
+        }
+        ASSERT_EQ(L1, V1);
+        for (size_t i = 0; i < V1.size(); ++i)
+            EXPECT_EQ(L1[i], V1[i]);
+
+        while (V1.size()){
+            L1.push_back(1);                                // the tail is kept through erases
+            V1.push_back(1);
+            size_t pos = rnd() % V1.size();
+            EXPECT_EQ(L1.erase(pos), V1[pos]);
+            V1.erase(V1.begin() + pos);
+            EXPECT_EQ(L1.erase(0), V1.front());
+            V1.erase(V1.begin());
+        }
+        EXPECT_EQ(L1.size(), 0);
+        EXPECT_EQ(L1.levels(), 0);
+    }
+}
+
+TEST(SkipList, logarithmicLevels){
+    skipList<std::string> L1;
+    std::list<std::string> S1;
+    for (int i = 0; i < 100000; ++i){
+        L1.push_back(std::to_string(i));
+        S1.push_back(std::to_string(i));
+    }
+    EXPECT_GE(L1.levels(), 5);
+    EXPECT_LE(L1.levels(), 12);
+
+    skipList<std::string> L2(L1);
+    L1[50000] = "changed";
+    EXPECT_EQ(L2, S1);
+    EXPECT_EQ(L1[50000], "changed");
+    skipList<std::string> L3(std::move(L2));
+    EXPECT_EQ(L3, S1);
+    EXPECT_EQ(L2.size(), 0);
+    L2 = std::move(L3);
+    L2.push_front("front");
+    S1.push_front("front");
+    EXPECT_EQ(L2, S1);
+}
+
+TEST(SharedPool, manySmallLists){
+    static_assert(sizeof(linkedList<int>) == 4 * sizeof(uint32_t) + 2 * sizeof(void*));    // no pool or defrag state inside
+    linkedList<int>::pool_type pool;
+    std::vector<linkedList<int>> lists;
+    std::vector<std::list<int>> expected(1000);
+    for (size_t i = 0; i < expected.size(); ++i)
+        lists.emplace_back(pool);
+    for (int i = 0; i < 20000; ++i){
+        size_t k = rnd() % lists.size();
+        int a = rnd();
+        lists[k].push_back(a);
+        expected[k].push_back(a);
+    }
+    for (size_t k = 0; k < lists.size(); ++k)
+        EXPECT_EQ(lists[k], expected[k]);
+    EXPECT_LT(pool.slots(), 20000 + 256);                   // one pool, not a slab per list
+
+    size_t slots = pool.slots();
+    for (auto &list : lists)
+        list.clear();
+    for (int i = 0; i < 20000; ++i)
+        lists[rnd() % lists.size()].push_front(i);
+    EXPECT_EQ(pool.slots(), slots);                         // cleared chains are reused
+
+    linkedList<int> copy(lists[0]);
+    EXPECT_TRUE(copy.shared());
+    EXPECT_EQ(copy, lists[0]);
+    lists.clear();                                          // destructors hand the nodes back
+    for (int i = 0; i < 20000; ++i)
+        copy.push_back(i);
+    EXPECT_EQ(pool.slots(), slots);
+}
+
+TEST(SharedPool, spliceAndMerge){
+    for (int k = 0; k < 100; ++k){
+        linkedList<int>::pool_type pool;
+        linkedList<int> L1(pool), L2(pool);
+        std::list<int> S1, S2;
+        for (int i = 0; i < rnd() % 50; ++i){
+            int a = rnd() % 100;
+            L1.push_back(a);
+            S1.push_back(a);
+        }
+        for (int i = 0; i < rnd() % 50; ++i){
+            int a = rnd() % 100;
+            L2.push_back(a);
+            S2.push_back(a);
+        }
+        switch (rnd() % 4){
+        case 0:
+            L1.splice_front(L2);
+            S1.splice(S1.begin(), S2);
+            break;
+        case 1:
+            L1.splice_back(L2);
+            S1.splice(S1.end(), S2);
+            break;
+        case 2:
+            if (S1.size()){
+                L1.splice_after(L1.begin(), L2);
+                S1.splice(std::next(S1.begin()), S2);
+            }
+            break;
+        default:
+            if (S2.size()){
+                L1.splice_front(L2, L2.end());              // first node of L2
+                S1.splice(S1.begin(), S2, S2.begin());
+            }
+            if (S1.size() && S2.size() > 1){
+                L1.splice_after(L1.begin(), L2, L2.begin());
+                S1.splice(std::next(S1.begin()), S2, std::next(S2.begin()));
+            }
+        }
+        EXPECT_EQ(L1, S1);
+        EXPECT_EQ(L2, S2);
+        L2.push_back(179);                                  // both tails are still right
+        S2.push_back(179);
+        L1.push_back(179);
+        S1.push_back(179);
+        EXPECT_EQ(L1, S1);
+        EXPECT_EQ(L2, S2);
+
+        L1.clear();
+        S1.clear();
+        L2.clear();
+        S2.clear();
+        for (int i = 0; i < rnd() % 50; ++i){
+            L1.push_back(i * 3);
+            S1.push_back(i * 3);
+        }
+        for (int i = 0; i < rnd() % 50; ++i){
+            L2.push_back(i * 2);
+            S2.push_back(i * 2);
+        }
+        L1.merge(L2);
+        S1.merge(S2);
+        EXPECT_EQ(L1, S1);
+        EXPECT_EQ(L2.size(), 0);
+        L1.push_back(1000);
+        S1.push_back(1000);
+        EXPECT_EQ(L1, S1);
+    }
+}
+
+TEST(SharedPool, differentPools){
+    linkedList<std::string>::pool_type pool;
+    linkedList<std::string> L1(pool), L2;
+    std::list<std::string> S1, S2;
+    for (int i = 0; i < 300; ++i){
+        L1.push_back(std::to_string(i));
+        S1.push_back(std::to_string(i));
+        L2.push_back(std::to_string(-i));
+        S2.push_back(std::to_string(-i));
+    }
+    L1.splice_after(L1.begin(), L2, L2.begin());           // values are moved between the pools
+    S1.splice(std::next(S1.begin()), S2, std::next(S2.begin()));
+    L2.splice_back(L1);
+    S2.splice(S2.end(), S1);
+    EXPECT_EQ(L1, S1);
+    EXPECT_EQ(L2, S2);
+
+    L1 = L2;                                                // copy into the shared pool
+    EXPECT_TRUE(L1.shared());
+    EXPECT_EQ(L1, S2);
+    L2 = std::move(L1);                                     // L2 now uses the shared pool
+    EXPECT_TRUE(L2.shared());
+    EXPECT_EQ(L2, S2);
+}
+
+TEST(Algorithms, sortIsStable){
+    for (int k = 0; k < 100; ++k){
+        linkedList<std::pair<int, int>> L1;
+        std::vector<std::pair<int, int>> V1;
+        size_t n = rnd() % 1000;
+        for (size_t i = 0; i < n; ++i){
+            std::pair<int, int> a(rnd() % 50, i);
+            L1.push_back(a);
+            V1.push_back(a);
+        }
+        auto by_key = [](const auto &a, const auto &b){ return a.first < b.first; };
+        struct Key{                                         // operator< on the key only
+            std::pair<int, int> p;
+            bool operator<(const Key &other) const { return p.first < other.p.first; }
+            bool operator!=(const std::pair<int, int> &other) const { return p != other; }
+        };
+        linkedList<Key> L2;
+        for (auto &a : V1)
+            L2.push_back({a});
+        L2.sort();
+        std::stable_sort(V1.begin(), V1.end(), by_key);
+        EXPECT_EQ(L2, V1);
+
+        L1.sort();
+        std::sort(V1.begin(), V1.end());
+        EXPECT_EQ(L1, V1);
+        L1.push_back({100, 0});                             // the tail is the last sorted node
+        V1.push_back({100, 0});
+        EXPECT_EQ(L1, V1);
+    }
+}
+
+TEST(Algorithms, reverseUniqueRemove){
+    for (int k = 0; k < 100; ++k){
+        linkedList<int> L1;
+        std::list<int> S1;
+        for (int i = 0; i < rnd() % 500; ++i){
+            int a = rnd() % 10;
+            L1.push_back(a);
+            S1.push_back(a);
+        }
+        L1.reverse();
+        S1.reverse();
+        EXPECT_EQ(L1, S1);
+
+        size_t before = S1.size();
+        EXPECT_EQ(L1.unique(), before - (S1.unique(), S1.size()));
+        EXPECT_EQ(L1, S1);
+
+        auto odd = [](int a){ return a % 2; };
+        before = S1.size();
+        EXPECT_EQ(erase_if(L1, odd), before - (S1.remove_if(odd), S1.size()));
+        EXPECT_EQ(L1, S1);
+        EXPECT_EQ(L1.remove(4), std::erase(S1, 4));
+        EXPECT_EQ(L1, S1);
+
+        L1.push_back(7);
+        S1.push_back(7);
+        L1.push_front(8);
+        S1.push_front(8);
+        EXPECT_EQ(L1, S1);
+    }
+
+    linkedList<int>::pool_type pool;                        // freed nodes go back to the shared pool
+    linkedList<int> L2(pool);
+    for (int i = 0; i < 1000; ++i)
+        L2.push_back(i / 3);
+    size_t slots = pool.slots();
+    L2.unique();
+    L2.remove_if([](int a){ return a < 100; });
+    EXPECT_EQ(L2.size(), 234);
+    for (int i = 0; i < 766; ++i)
+        L2.push_front(i);
+    EXPECT_EQ(pool.slots(), slots);
+}
+
+TEST(Iterators, references){
+    linkedList<std::string> L1;
+    for (int i = 0; i < 1000; ++i)
+        L1.push_back(std::to_string(i));
+    for (auto &elem : L1)                                   // in place, through the reference
+        elem += "!";
+    const auto &C1 = L1;
+    size_t i = 0;
+    for (const std::string &elem : C1)
+        EXPECT_EQ(elem, std::to_string(i++) + "!");
+    EXPECT_EQ(&*L1.begin(), &L1[0]);
+    EXPECT_EQ(L1.begin()->size(), 2);
+
+    linkedList<std::string>::ConstIterator it = L1.begin(); // mutable converts to const
+    EXPECT_EQ(*it, "0!");
+    EXPECT_TRUE(it == L1.cbegin());
+    std::vector<std::string> V1(C1.begin(), C1.end());
+    EXPECT_EQ(L1, V1);
+    EXPECT_EQ(std::find(L1.begin(), L1.end(), "500!"), std::next(L1.begin(), 500));
+}
+
+TEST(Iterators, prefetch){
+    linkedList<int> L1;
+    std::vector<linkedList<int>::Iterator> nodes;
+    std::list<int> S1;
+    L1.push_back(0);
+    nodes.push_back(L1.begin());
+    for (int i = 1; i < 10000; ++i)
+        nodes.push_back(L1.insert_after(nodes[rnd() % nodes.size()], i));
+    for (int elem : L1)
+        S1.push_back(elem);
+
+    for (size_t k : {1, 8, 20000}){                         // longer than the list: prefetching just stays off
+        L1.set_prefetch(k);
+        EXPECT_EQ(L1, S1);
+        for (auto &elem : L1)
+            elem *= 2;
+        for (auto &elem : S1)
+            elem *= 2;
+        EXPECT_EQ(L1, S1);
+    }
+    L1.set_prefetch(0);
+    EXPECT_EQ(L1, S1);
+}
+
+template<bool XOR>
+void random_doubly_ops(){
+    for (int k = 0; k < 200; ++k){
+        doublyLinkedList<int, uint32_t, XOR> L1;
+        std::list<int> S1;
+        for (int i = 0; i < 300; ++i){
+            size_t pos = S1.empty() ? 0 : rnd() % (S1.size() + 1);
+            auto it1 = std::next(L1.begin(), pos);
+            auto it2 = std::next(S1.begin(), pos);
+            int a = rnd();
+            switch (rnd() % 6){
+            case 0:  L1.push_front(a); S1.push_front(a); break;
+            case 1:  L1.push_back(a); S1.push_back(a); break;
+            case 2:  EXPECT_EQ(*L1.insert(it1, a), *S1.insert(it2, a)); break;
+            case 3:
+                if (it2 != S1.end()){
+                    auto next1 = L1.erase(it1);
+                    auto next2 = S1.erase(it2);
+                    EXPECT_EQ(next1 == L1.end(), next2 == S1.end());
+                    if (next2 != S1.end()){
+                        EXPECT_EQ(*next1, *next2);
+                    }
+                }
+                break;
+            case 4:
+                if (!S1.empty()){
+                    EXPECT_EQ(L1.pop_back(), S1.back());
+                    S1.pop_back();
+                }
+                break;
+            default:
+                if (!S1.empty()){
+                    size_t from = rnd() % S1.size();
+                    L1.splice(it1, std::next(L1.begin(), from));
+                    S1.splice(it2, S1, std::next(S1.begin(), from));
+                }
+            }
+            ASSERT_EQ(L1, S1);
+        }
+        EXPECT_TRUE(std::equal(L1.rbegin(), L1.rend(), S1.rbegin(), S1.rend()));
+        if (!S1.empty()){
+            EXPECT_EQ(L1.front(), S1.front());
+            EXPECT_EQ(L1.back(), S1.back());
+            EXPECT_EQ(L1.pop_front(), S1.front());
+            S1.pop_front();
+        }
+
+        auto L2(L1), L3(std::move(L1));
+        EXPECT_EQ(L2, S1);
+        EXPECT_EQ(L3, S1);
+        L3.clear();
+        EXPECT_EQ(L3.size(), 0);
+        EXPECT_TRUE(L3.begin() == L3.end());
+    }
+}
+
+TEST(Doubly, randomOps){
+    random_doubly_ops<false>();
+}
+
+TEST(Doubly, xorLinked){
+    random_doubly_ops<true>();
+    EXPECT_LT(sizeof(doublyLinkedList<int, uint32_t, true>::Node), sizeof(doublyLinkedList<int, uint32_t, false>::Node));
+}
+
+TEST(Doubly, bidirectionalIterators){
+    doublyLinkedList<std::string> L1;
+    for (int i = 0; i < 100; ++i)
+        L1.push_back(std::to_string(i));
+
+    auto it = L1.end();
+    for (int i = 99; i >= 0; --i)
+        EXPECT_EQ(*--it, std::to_string(i));
+    EXPECT_TRUE(it == L1.begin());
+    for (auto &elem : L1)
+        elem += "!";
+    EXPECT_EQ(std::prev(L1.end())->size(), 3);
+    doublyLinkedList<std::string>::ConstIterator c = std::next(L1.begin(), 10);
+    EXPECT_EQ(*c, "10!");
+
+    auto end = L1.end();                                    // end() stays valid while pushing at the back
+    L1.push_back("tail");
+    EXPECT_EQ(*std::prev(end), "tail");
+
+    for (it = L1.begin(); it != L1.end(); )                 // O(1) erase while walking
+        it = it->size() == 3 ? L1.erase(it) : std::next(it);
+    EXPECT_EQ(L1.size(), 11);                               // "0!" .. "9!" and "tail"
+    EXPECT_EQ(L1.front(), "0!");
+}
+
 
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,302 @@
+#ifndef UNROLLEDLIST_HPP
+#define UNROLLEDLIST_HPP
+
+#include "linkedlist.hpp"
+
+
+//==========================================
+// Unrolled linked list
+//
+// Same interface as linkedList, but every pool node is a block of up to B elements.
+// A full block is split in halves on insert; a block that drops below half is merged
+// with its successor when both fit into one. Walking to a position costs one link per
+// block instead of one per element.
+
+template<typename T, size_t B = 16, typename Index = uint32_t>
+class unrolledList {
+    static_assert(B >= 2, "a block has to hold two halves");
+
+public:
+    struct Block{
+        Index next_;
+        Index count_;
+        T vals_[B];
+    };
+
+    static constexpr Index NIL = Index(-1);
+
+private:
+    Index head_;
+    Index tail_;                    // id of the last block, NIL for an empty list
+    size_t size_;
+    ObjPool<Block, Index> pool;
+
+    Index new_block( Index next );
+    Index locate( size_t &n, Index *prev = nullptr ) const;    // block holding position n, n becomes the offset in it
+    void  split( Index id );
+    void  merge_next( Index id );
+
+public:
+    //===================================
+    //  Interface functions
+
+    unrolledList() : head_(NIL), tail_(NIL), size_(0) {}
+    unrolledList( const unrolledList &other ) = default;
+    unrolledList( unrolledList &&other ) : head_(other.head_), tail_(other.tail_), size_(other.size_), pool(std::move(other.pool)) { other.head_ = other.tail_ = NIL; other.size_ = 0; }
+
+    unrolledList& operator=( const unrolledList &other ) = default;
+    unrolledList& operator=( unrolledList &&other ) { head_ = exchange(other.head_, NIL); tail_ = exchange(other.tail_, NIL); size_ = exchange(other.size_, 0); pool = std::move(other.pool); return *this; }
+
+
+    void insert( const T &val ) { insert(0, val); };
+    void insert( size_t n, const T &val );
+    T erase( size_t n = 0 );
+
+    void push_front( const T &val );
+    void push_back ( const T &val );
+
+    size_t size()   const { return size_; }
+    size_t blocks() const;
+
+    template<class Container>
+    bool operator==( const Container &other ) const;
+    template<class Container>
+    bool operator!=( const Container &other ) const { return !(*this == other); }
+
+    void dump(std::ostream &out) const;        //DEBUG
+
+    T& operator[](size_t n);
+    const T& operator[](size_t n) const;
+
+    //===================================
+    //  Iterators
+
+    struct Iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = T;
+
+        Iterator( Index id = NIL, Index pos = 0, const ObjPool<Block, Index> *pool = nullptr ) : pool_(pool), id_(id), pos_(pos) {};
+        Iterator( const Iterator &other ) = default;
+
+        bool operator==( const Iterator &other ) const { return id_ == other.id_ && pos_ == other.pos_; }
+        bool operator!=( const Iterator &other ) const { return !(*this == other); }
+
+        T operator*() { assert(id_ != NIL); return pool_->get(id_)->vals_[pos_]; }
+        const T operator*() const { assert(id_ != NIL); return pool_->get(id_)->vals_[pos_]; }
+
+        Iterator operator++() {
+            const Block *b = pool_->get(id_);
+            if (++pos_ == b->count_){
+                id_ = b->next_;
+                pos_ = 0;
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator result(*this);
+            ++(*this);
+            return result;
+        }
+
+
+    private:
+        const ObjPool<Block, Index> *pool_;
+        Index id_;
+        Index pos_;
+
+    };
+
+    Iterator begin() const { return Iterator(head_, 0, &pool); }
+    Iterator end()   const { return Iterator(  NIL, 0, &pool); }
+};
+
+template<typename T, size_t B, typename Index>
+Index unrolledList<T, B, Index>::new_block(Index next) {
+    Index id = pool.alloc();
+    Block *b = pool.get(id);
+    b->next_ = next;
+    b->count_ = 0;
+    if (next == NIL)
+        tail_ = id;
+    return id;
+}
+
+template<typename T, size_t B, typename Index>
+Index unrolledList<T, B, Index>::locate(size_t &n, Index *prev) const {
+    Index before = NIL;
+    Index id = head_;
+    while (n >= pool.get(id)->count_ && pool.get(id)->next_ != NIL){
+        n -= pool.get(id)->count_;
+        before = id;
+        id = pool.get(id)->next_;
+    }
+    if (prev)
+        *prev = before;
+    return id;
+}
+
+// Moves the upper half of a full block into a new block right after it
+template<typename T, size_t B, typename Index>
+void unrolledList<T, B, Index>::split(Index id) {
+    Index nid = new_block(pool.get(id)->next_);
+    Block *b = pool.get(id);                                    // alloc() may have added a slab, but never moves one
+    Block *nb = pool.get(nid);
+    size_t half = b->count_ / 2;
+    for (size_t i = half; i < b->count_; ++i)
+        nb->vals_[i - half] = std::move(b->vals_[i]);
+    nb->count_ = static_cast<Index>(b->count_ - half);
+    b->count_ = static_cast<Index>(half);
+    b->next_ = nid;
+}
+
+template<typename T, size_t B, typename Index>
+void unrolledList<T, B, Index>::merge_next(Index id) {
+    Block *b = pool.get(id);
+    Index nid = b->next_;
+    Block *nb = pool.get(nid);
+    assert(b->count_ + nb->count_ <= B);
+    for (size_t i = 0; i < nb->count_; ++i)
+        b->vals_[b->count_ + i] = std::move(nb->vals_[i]);
+    b->count_ += nb->count_;
+    b->next_ = nb->next_;
+    if (tail_ == nid)
+        tail_ = id;
+    pool.free(nid);
+}
+
+template<typename T, size_t B, typename Index>
+void unrolledList<T, B, Index>::push_front(const T &val) {
+    if (head_ == NIL || pool.get(head_)->count_ == B)
+        head_ = new_block(head_);
+    Block *b = pool.get(head_);
+    for (size_t i = b->count_; i > 0; --i)
+        b->vals_[i] = std::move(b->vals_[i - 1]);
+    b->vals_[0] = val;
+    ++b->count_;
+    ++size_;
+}
+
+template<typename T, size_t B, typename Index>
+void unrolledList<T, B, Index>::push_back(const T &val) {
+    if (tail_ == NIL)
+        head_ = new_block(NIL);
+    else if (pool.get(tail_)->count_ == B){
+        Index old_tail = tail_;                                 // a full tail stays full, appends start a new block
+        Index id = new_block(NIL);
+        pool.get(old_tail)->next_ = id;
+    }
+    Block *b = pool.get(tail_);
+    b->vals_[b->count_++] = val;
+    ++size_;
+}
+
+template<typename T, size_t B, typename Index>
+void unrolledList<T, B, Index>::insert(size_t n, const T &val) {
+    assert(n <= size_);
+    if (n == 0){
+        push_front(val);
+        return;
+    }
+    if (n == size_){
+        push_back(val);
+        return;
+    }
+    Index id = locate(n);
+    if (pool.get(id)->count_ == B){
+        split(id);
+        Block *b = pool.get(id);
+        if (n > b->count_){
+            n -= b->count_;
+            id = b->next_;
+        }
+    }
+    Block *b = pool.get(id);
+    for (size_t i = b->count_; i > n; --i)
+        b->vals_[i] = std::move(b->vals_[i - 1]);
+    b->vals_[n] = val;
+    ++b->count_;
+    ++size_;
+}
+
+template<typename T, size_t B, typename Index>
+T unrolledList<T, B, Index>::erase(size_t n) {
+    assert(n < size_);
+    Index prev;
+    Index id = locate(n, &prev);
+    Block *b = pool.get(id);
+    T result = std::move(b->vals_[n]);
+    for (size_t i = n + 1; i < b->count_; ++i)
+        b->vals_[i - 1] = std::move(b->vals_[i]);
+    --b->count_;
+    --size_;
+
+    if (!b->count_){
+        if (prev == NIL)
+            head_ = b->next_;
+        else
+            pool.get(prev)->next_ = b->next_;
+        if (tail_ == id)
+            tail_ = prev;
+        pool.free(id);
+    }
+    else if (b->count_ < B / 2 && b->next_ != NIL && b->count_ + pool.get(b->next_)->count_ <= B)
+        merge_next(id);
+    return result;
+}
+
+template<typename T, size_t B, typename Index>
+size_t unrolledList<T, B, Index>::blocks() const {
+    size_t result = 0;
+    for (Index id = head_; id != NIL; id = pool.get(id)->next_)
+        ++result;
+    return result;
+}
+
+template<typename T, size_t B, typename Index>
+void unrolledList<T, B, Index>::dump(std::ostream &out) const {
+    out << "head = " << head_ << '\n';
+    out << "size = " << size_ << '\n';
+    for (Index id = head_; id != NIL; id = pool.get(id)->next_){
+        const Block *b = pool.get(id);
+        out << "[ ";
+        for (size_t i = 0; i < b->count_; ++i)
+            out << b->vals_[i] << ' ';
+        out << "] ";
+    }
+    out << '\n';
+}
+
+template<typename T, size_t B, typename Index>
+template<class Container>
+bool unrolledList<T, B, Index>::operator==(const Container &other) const {
+    if (size() != other.size()){
+        return false;
+    }
+
+    Iterator iter_1 = begin();
+    auto iter_2 = other.begin();
+    while (iter_1 != end()) {
+        if (*iter_1 != *iter_2)
+            return false;
+        ++iter_1; ++iter_2;
+    }
+    return true;
+}
+
+template<typename T, size_t B, typename Index>
+T& unrolledList<T, B, Index>::operator[](size_t n) {
+    assert(n < size_);
+    Index id = locate(n);
+    return pool.get(id)->vals_[n];
+}
+
+template<typename T, size_t B, typename Index>
+const T& unrolledList<T, B, Index>::operator[](size_t n) const {
+    assert(n < size_);
+    Index id = locate(n);
+    return pool.get(id)->vals_[n];
+}
+
+#endif
@@ -0,0 +1,75 @@
+#include "lockfreequeue.hpp"
+#include "../linkedList/linkedlist.hpp"
+
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <mutex>
+
+
+// Producers and consumers in equal numbers move ITEMS values through one queue.
+
+const uint64_t ITEMS = 4000000;
+
+template<class Make, class Push, class Pop>
+double run(size_t pairs, Make make, Push push, Pop pop, uint64_t &check)
+{
+    std::vector<std::thread> workers;
+    std::atomic<uint64_t> sum(0);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < pairs; ++t){
+        workers.emplace_back([&, t](){
+            auto state = make();
+            for (uint64_t i = t; i < ITEMS; i += pairs)
+                push(state, i);
+        });
+        workers.emplace_back([&, t](){
+            auto state = make();
+            uint64_t val, local = 0;
+            for (uint64_t i = t; i < ITEMS; i += pairs){
+                while (!pop(state, val))
+                    std::this_thread::yield();
+                local += val;
+            }
+            sum.fetch_add(local);
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    check += sum.load();
+    return ITEMS / time / 1e6;
+}
+
+int main()
+{
+    std::cout << "M items per second through one queue, " << std::thread::hardware_concurrency() << " hardware threads\n";
+    std::cout << "pairs\tlinkedList+mutex\tlockFreeQueue\tlockFreeQueue+Cache\n";
+    for (size_t pairs = 1; pairs <= 16; pairs *= 2){
+        uint64_t check_1 = 0, check_2 = 0, check_3 = 0;
+
+        linkedList<uint64_t> list;
+        std::mutex lock;
+        double m = run(pairs, [](){ return 0; },
+                       [&](int, uint64_t val){ std::lock_guard<std::mutex> guard(lock); list.push_back(val); },
+                       [&](int, uint64_t &val){
+                           std::lock_guard<std::mutex> guard(lock);
+                           if (!list.size())
+                               return false;
+                           val = list.erase(0);
+                           return true;
+                       }, check_1);
+
+        lockFreeQueue<uint64_t> shared;
+        double s = run(pairs, [](){ return 0; },
+                       [&](int, uint64_t val){ shared.enqueue(val); },
+                       [&](int, uint64_t &val){ return shared.dequeue(val); }, check_2);
+
+        lockFreeQueue<uint64_t> cached;
+        double c = run(pairs, [&](){ return cached.cache(); },
+                       [&](auto &cache, uint64_t val){ cached.enqueue(cache, val); },
+                       [&](auto &cache, uint64_t &val){ return cached.dequeue(cache, val); }, check_3);
+
+        std::cout << pairs << '\t' << m << "\t\t\t" << s << "\t\t" << c << "\t(checksum diff " << (check_1 - check_2) + (check_1 - check_3) << ")\n";
+    }
+}
@@ -0,0 +1,176 @@
+#ifndef LOCKFREEQUEUE_HPP
+#define LOCKFREEQUEUE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <cstring>
+
+#include "../concurrentPool/concurrentpool.hpp"
+
+
+//==========================================
+// Lock-free MPMC queue (Michael & Scott)
+//
+// A linked list with a dummy node in front, nodes come from a ConcurrentObjPool and
+// go back to its free stack after dequeue. Head, tail and every next link pack a
+// 32-bit id with a 32-bit tag bumped on each update, so one 64-bit CAS replaces a
+// tagged pointer and a recycled node can never pass for the one a stalled thread saw.
+// A reused node keeps its tag, which is what makes a late CAS on its link fail.
+// Slabs outlive the queue, so reading a node that was just freed is harmless: the
+// value is copied before the head CAS decides whether the copy counts. To keep that
+// racing copy well defined T is stored as relaxed atomic words, hence it has to be
+// trivially copyable.
+
+template<typename T, size_t BASE_BITS = 10>
+class lockFreeQueue{
+    static_assert(std::is_trivially_copyable_v<T>, "dequeue copies the value before it owns the node");
+
+    static constexpr size_t WORDS = (sizeof(T) + 7) / 8;
+
+    struct Node{
+        std::atomic<uint64_t> next;                         // tag << 32 | id
+        std::atomic<uint64_t> val[WORDS];
+    };
+
+public:
+    using pool_type = ConcurrentObjPool<Node, BASE_BITS>;
+    using Cache     = typename pool_type::Cache;
+
+    static constexpr uint32_t NIL = pool_type::NIL;
+
+    lockFreeQueue()
+    {
+        uint32_t dummy = pool.alloc();
+        pool.get(dummy)->next.store(pack(0, NIL), std::memory_order_relaxed);
+        head.store(pack(0, dummy), std::memory_order_relaxed);
+        tail.store(pack(0, dummy), std::memory_order_relaxed);
+    }
+    lockFreeQueue(const lockFreeQueue &other) = delete;
+    lockFreeQueue& operator=(const lockFreeQueue &other) = delete;
+
+    void enqueue(const T &val)              { link(pool.alloc(), val); }
+    void enqueue(Cache &cache, const T &val) { link(cache.alloc(), val); }
+
+    bool dequeue(T &val)                    // false if the queue was empty
+    {
+        uint32_t id = unlink(val);
+        if (id == NIL)
+            return false;
+        pool.free(id);
+        return true;
+    }
+
+    bool dequeue(Cache &cache, T &val)
+    {
+        uint32_t id = unlink(val);
+        if (id == NIL)
+            return false;
+        cache.free(id);
+        return true;
+    }
+
+    Cache cache() { return Cache(pool); }   // one per thread, ids go back to the pool when it dies
+
+    bool     empty() const;                 // a snapshot, may be stale by the time it returns
+    uint32_t capacity() const { return pool.capacity(); }   // nodes handed out so far
+
+
+private:
+    pool_type             pool;
+    alignas(64) std::atomic<uint64_t> head;                 // tag << 32 | id of the dummy node
+    alignas(64) std::atomic<uint64_t> tail;                 // the last node or, briefly, the one before it
+
+    static uint64_t pack(uint64_t tag, uint32_t id) { return (tag << 32) | id; }
+    static uint32_t id_of(uint64_t link)            { return static_cast<uint32_t>(link); }
+    static uint64_t tag_of(uint64_t link)           { return link >> 32; }
+
+    static void store(Node *v, const T &val);
+    static T    load(const Node *v);
+
+    void     link(uint32_t id, const T &val);
+    uint32_t unlink(T &val);                // returns the old dummy to free, NIL if empty
+};
+
+
+template<typename T, size_t BASE_BITS>
+void lockFreeQueue<T, BASE_BITS>::store(Node *v, const T &val)
+{
+    uint64_t words[WORDS] = {};
+    std::memcpy(words, &val, sizeof(T));
+    for (size_t i = 0; i < WORDS; ++i)
+        v->val[i].store(words[i], std::memory_order_relaxed);
+}
+
+template<typename T, size_t BASE_BITS>
+T lockFreeQueue<T, BASE_BITS>::load(const Node *v)
+{
+    uint64_t words[WORDS];
+    for (size_t i = 0; i < WORDS; ++i)
+        words[i] = v->val[i].load(std::memory_order_relaxed);
+    T val;
+    std::memcpy(&val, words, sizeof(T));
+    return val;
+}
+
+template<typename T, size_t BASE_BITS>
+void lockFreeQueue<T, BASE_BITS>::link(uint32_t id, const T &val)
+{
+    Node *v = pool.get(id);
+    store(v, val);                                          // published by the release CAS on the link
+    v->next.store(pack(tag_of(v->next.load(std::memory_order_relaxed)) + 1, NIL), std::memory_order_relaxed);
+
+    while (true)
+    {
+        uint64_t t = tail.load(std::memory_order_acquire);
+        Node *last = pool.get(id_of(t));
+        uint64_t next = last->next.load(std::memory_order_acquire);
+        if (t != tail.load(std::memory_order_acquire))
+            continue;
+        if (id_of(next) != NIL)
+        {
+            tail.compare_exchange_strong(t, pack(tag_of(t) + 1, id_of(next)), std::memory_order_release, std::memory_order_relaxed);
+            continue;                                       // helped a lagging tail, try again
+        }
+        if (last->next.compare_exchange_weak(next, pack(tag_of(next) + 1, id), std::memory_order_release, std::memory_order_relaxed))
+        {
+            tail.compare_exchange_strong(t, pack(tag_of(t) + 1, id), std::memory_order_release, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+template<typename T, size_t BASE_BITS>
+uint32_t lockFreeQueue<T, BASE_BITS>::unlink(T &val)
+{
+    while (true)
+    {
+        uint64_t h = head.load(std::memory_order_acquire);
+        uint64_t t = tail.load(std::memory_order_acquire);
+        uint64_t next = pool.get(id_of(h))->next.load(std::memory_order_acquire);
+        if (h != head.load(std::memory_order_acquire))
+            continue;
+        if (id_of(h) == id_of(t))
+        {
+            if (id_of(next) == NIL)
+                return NIL;
+            tail.compare_exchange_strong(t, pack(tag_of(t) + 1, id_of(next)), std::memory_order_release, std::memory_order_relaxed);
+            continue;
+        }
+        T copy = load(pool.get(id_of(next)));               // after the CAS another dequeuer may recycle next
+        if (head.compare_exchange_weak(h, pack(tag_of(h) + 1, id_of(next)), std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            val = copy;
+            return id_of(h);
+        }
+    }
+}
+
+template<typename T, size_t BASE_BITS>
+bool lockFreeQueue<T, BASE_BITS>::empty() const
+{
+    uint64_t h = head.load(std::memory_order_acquire);
+    return id_of(pool.get(id_of(h))->next.load(std::memory_order_acquire)) == NIL;
+}
+
+#endif
@@ -0,0 +1,99 @@
+#include "lockfreequeue.hpp"
+
+#include <random>
+#include <vector>
+#include <deque>
+#include <thread>
+#include "gtest/gtest.h"
+
+
+TEST(Basics, SingleThread)
+{
+    lockFreeQueue<uint64_t, 2> Q1;
+    std::deque<uint64_t> D1;
+    std::mt19937 rnd(179);
+    uint64_t val;
+    EXPECT_TRUE(Q1.empty());
+    EXPECT_FALSE(Q1.dequeue(val));
+    for (int i = 0; i < 100000; ++i){
+        if (rnd() % 2){
+            Q1.enqueue(i);
+            D1.push_back(i);
+        }
+        else {
+            ASSERT_EQ(Q1.dequeue(val), !D1.empty());
+            if (!D1.empty()){
+                EXPECT_EQ(val, D1.front());
+                D1.pop_front();
+            }
+        }
+        ASSERT_EQ(Q1.empty(), D1.empty());
+    }
+}
+
+TEST(Basics, NodesAreReused)
+{
+    lockFreeQueue<int, 2> Q1;
+    auto cache = Q1.cache();
+    int val;
+    for (int round = 0; round < 1000; ++round){
+        for (int i = 0; i < 100; ++i)
+            Q1.enqueue(cache, i);
+        for (int i = 0; i < 100; ++i){
+            ASSERT_TRUE(Q1.dequeue(cache, val));
+            EXPECT_EQ(val, i);
+        }
+    }
+    EXPECT_LE(Q1.capacity(), 1 + 100 + 2 * decltype(Q1)::Cache::SIZE);
+}
+
+// Every producer enqueues an increasing sequence, so each consumer has to see
+// each producer's values in order, and all of them have to come out exactly once
+TEST(Concurrent, ProducersAndConsumers)
+{
+    const size_t PRODUCERS = 4, CONSUMERS = 4;
+    const uint64_t ITEMS = 100000;                          // per producer
+    lockFreeQueue<uint64_t, 4> Q1;
+    std::vector<std::vector<uint64_t>> seen(CONSUMERS, std::vector<uint64_t>(PRODUCERS));
+    std::atomic<uint64_t> taken(0);
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < PRODUCERS; ++p)
+        threads.emplace_back([&, p](){
+            auto cache = Q1.cache();
+            for (uint64_t i = 1; i <= ITEMS; ++i){
+                if (i % 2)
+                    Q1.enqueue(cache, p << 32 | i);
+                else
+                    Q1.enqueue(p << 32 | i);
+            }
+        });
+    for (size_t c = 0; c < CONSUMERS; ++c)
+        threads.emplace_back([&, c](){
+            auto cache = Q1.cache();
+            uint64_t val;
+            while (taken.load() < PRODUCERS * ITEMS){
+                if (!(c % 2 ? Q1.dequeue(cache, val) : Q1.dequeue(val))){
+                    std::this_thread::yield();
+                    continue;
+                }
+                taken.fetch_add(1);
+                uint64_t p = val >> 32, i = val & 0xffffffff;
+                ASSERT_LT(p, PRODUCERS);
+                EXPECT_LT(seen[c][p], i);
+                seen[c][p] = i;
+            }
+        });
+    for (auto &thread : threads)
+        thread.join();
+
+    uint64_t val;
+    EXPECT_FALSE(Q1.dequeue(val));
+    EXPECT_EQ(taken.load(), PRODUCERS * ITEMS);
+}
+
+
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
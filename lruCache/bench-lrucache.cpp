@@ -0,0 +1,107 @@
+#include "lrucache.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <list>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include <new>
+#include <cstdlib>
+
+
+// Get-or-put over a skewed key stream, the way a cache in front of a slow lookup is used
+
+size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if (void *p = std::malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+const size_t KEYS     = 1 << 20;
+const size_t CAPACITY = 1 << 16;
+const size_t OPS      = 1 << 23;
+
+struct NodeCache{
+    std::list<std::pair<uint64_t, uint64_t>> list;
+    std::unordered_map<uint64_t, std::list<std::pair<uint64_t, uint64_t>>::iterator> index;
+
+    uint64_t fetch( uint64_t key ) {
+        auto found = index.find(key);
+        if (found != index.end()){
+            list.splice(list.begin(), list, found->second);
+            return found->second->second;
+        }
+        if (list.size() == CAPACITY){
+            index.erase(list.back().first);
+            list.pop_back();
+        }
+        list.push_front({key, key * 3});
+        index[key] = list.begin();
+        return key * 3;
+    }
+};
+
+// Zipf(0.9)-like ranks by inverse transform of a continuous power law, mixed with scans
+std::vector<uint64_t> make_stream()
+{
+    std::mt19937_64 gen(179);
+    std::uniform_real_distribution<double> u(0, 1);
+    std::vector<uint64_t> stream(OPS);
+    const double s = 0.9;
+    for (size_t i = 0; i < OPS; ++i){
+        if (i % 4096 < 256)
+            stream[i] = KEYS + i;                           // cold scan keys
+        else
+            stream[i] = static_cast<uint64_t>(std::pow(1 + u(gen) * (std::pow(KEYS, 1 - s) - 1), 1 / (1 - s))) - 1;
+    }
+    return stream;
+}
+
+template<class Cache>
+void run( const char *name, Cache &cache, const std::vector<uint64_t> &stream, uint64_t &check )
+{
+    size_t before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t key : stream)
+        check += cache.fetch(key);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << seconds / OPS * 1e9 << " ns/op,  " << double(allocations - before) / OPS << " allocations/op";
+}
+
+template<cachePolicy Policy>
+struct Adapter{
+    lruCache<uint64_t, uint64_t, Policy> cache;
+    uint64_t fetch( uint64_t key ) { return cache.fetch(key, [](uint64_t k){ return k * 3; }); }
+};
+
+int main()
+{
+    auto stream = make_stream();
+    uint64_t check_1 = 0, check_2 = 0, check_3 = 0, check_4 = 0;
+    std::cout << OPS << " fetches over " << KEYS << " skewed keys with scans, capacity " << CAPACITY << '\n';
+
+    NodeCache node;
+    run("unordered_map + std::list:  ", node, stream, check_1);
+    std::cout << '\n';
+
+    Adapter<cachePolicy::LRU> lru{lruCache<uint64_t, uint64_t, cachePolicy::LRU>(CAPACITY)};
+    run("lruCache LRU:               ", lru, stream, check_2);
+    std::cout << "  (hit ratio " << double(lru.cache.stats().hits) / OPS << ")\n";
+
+    Adapter<cachePolicy::SLRU> slru{lruCache<uint64_t, uint64_t, cachePolicy::SLRU>(CAPACITY)};
+    run("lruCache SLRU:              ", slru, stream, check_3);
+    std::cout << "  (hit ratio " << double(slru.cache.stats().hits) / OPS << ")\n";
+
+    lru.cache.reset_stats();
+    run("lruCache LRU, warm cache:   ", lru, stream, check_4);      // steady state, nothing left to allocate
+    std::cout << "  (hit ratio " << double(lru.cache.stats().hits) / OPS << ")\n";
+    std::cout << "checksum diff " << (check_1 - check_2) + (check_1 - check_3) + (check_1 - check_4) << '\n';
+}
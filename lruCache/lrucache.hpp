@@ -0,0 +1,230 @@
+#ifndef LRUCACHE_HPP
+#define LRUCACHE_HPP
+
+#include <iostream>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include <bit>
+
+#include "../linkedList/doublylinkedlist.hpp"
+
+
+//==========================================
+// Fixed-capacity LRU cache
+//
+// Entries sit in doublyLinkedList recency lists, most recent at the front, so their
+// nodes come from ObjPool free lists and a full cache allocates nothing in steady
+// state. The index is an open-addressing table with linear probing: a slot keeps the
+// upper 32 bits of the key hash, which both place the slot and filter compares, and
+// the pool id of the entry. Erase shifts the following run back, so there are no
+// tombstones. With SLRU a new key enters the probation segment and a hit there
+// promotes it to the protected one (4/5 of the capacity), whose least recent entry
+// is demoted back; victims come from the probation tail, so one scan over many cold
+// keys cannot flush the hot ones.
+
+enum class cachePolicy { LRU, SLRU };
+
+struct cacheStats{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+template<typename K, typename V, cachePolicy Policy = cachePolicy::LRU, class Hash = std::hash<K>, class KeyEqual = std::equal_to<K>>
+class lruCache {
+public:
+    struct Entry{
+        K key;
+        V val;
+    };
+
+private:
+    using list_type = doublyLinkedList<Entry, uint32_t>;
+
+    static constexpr uint32_t EMPTY = uint32_t(-1);
+
+    struct Slot{
+        uint32_t hash;
+        uint32_t ref;                                       // id << 1 | segment, EMPTY for a free slot
+    };
+
+    size_t            capacity_;
+    size_t            protected_capacity_;                  // 0 for plain LRU
+    list_type         lists_[2];                            // probation (the only one for LRU), protected
+    std::vector<Slot> table_;
+    size_t            bits_;
+    cacheStats        stats_;
+    Hash              hasher_;
+    KeyEqual          equal_;
+
+    uint32_t hash( const K &key ) const { return uint32_t((uint64_t(hasher_(key)) * 0x9E3779B97F4A7C15ull) >> 32); }
+    size_t   home( uint32_t h ) const   { return h >> (32 - bits_); }
+    Entry&       entry( uint32_t ref )       { return *lists_[ref & 1].at(ref >> 1); }
+    const Entry& entry( uint32_t ref ) const { return *lists_[ref & 1].at(ref >> 1); }
+
+    size_t   find( const K &key, uint32_t h ) const;        // slot of key or the free slot that ends its run
+    void     erase_slot( size_t i );
+    void     touch( size_t i );                             // a hit on the entry of slot i
+    void     evict();
+
+public:
+    //===================================
+    //  Interface functions
+
+    explicit lruCache( size_t capacity );
+
+    V*   get( const K &key );                               // nullptr on a miss
+    bool put( const K &key, const V &val );                 // false if key was already cached and got updated
+    bool erase( const K &key );
+
+    template<class F>
+    V&   fetch( const K &key, F load );                     // load(key) runs on a miss, its result is cached
+
+    bool contains( const K &key ) const;                    // does not count or touch
+
+    size_t size()     const { return lists_[0].size() + lists_[1].size(); }
+    size_t capacity() const { return capacity_; }
+
+    const cacheStats& stats() const { return stats_; }
+    void reset_stats() { stats_ = cacheStats{0, 0, 0}; }
+
+    template<class F>
+    void for_each( F f ) const;                             // f(key, val) from the most recent entry, protected first
+
+    void dump(std::ostream &out) const;        //DEBUG
+};
+
+
+template<typename K, typename V, cachePolicy Policy, class Hash, class KeyEqual>
+lruCache<K, V, Policy, Hash, KeyEqual>::lruCache(size_t capacity)
+    : capacity_(capacity), protected_capacity_(Policy == cachePolicy::SLRU ? capacity * 4 / 5 : 0), stats_{0, 0, 0} {
+    assert(capacity > 0 && capacity < (size_t(1) << 30));
+    bits_ = std::bit_width(2 * capacity - 1);               // load factor stays at or below 1/2
+    table_.assign(size_t(1) << bits_, Slot{0, EMPTY});
+}
+
+template<typename K, typename V, cachePolicy Policy, class Hash, class KeyEqual>
+size_t lruCache<K, V, Policy, Hash, KeyEqual>::find(const K &key, uint32_t h) const {
+    size_t mask = table_.size() - 1;
+    size_t i = home(h);
+    while (table_[i].ref != EMPTY && !(table_[i].hash == h && equal_(entry(table_[i].ref).key, key)))
+        i = (i + 1) & mask;
+    return i;
+}
+
+// Backward shift: every later slot of the run whose home is not in (i, j] moves into the hole
+template<typename K, typename V, cachePolicy Policy, class Hash, class KeyEqual>
+void lruCache<K, V, Policy, Hash, KeyEqual>::erase_slot(size_t i) {
+    size_t mask = table_.size() - 1;
+    for (size_t j = (i + 1) & mask; table_[j].ref != EMPTY; j = (j + 1) & mask)
+        if (((j - home(table_[j].hash)) & mask) >= ((j - i) & mask)){
+            table_[i] = table_[j];
+            i = j;
+        }
+    table_[i].ref = EMPTY;
+}
+
+template<typename K, typename V, cachePolicy Policy, class Hash, class KeyEqual>
+void lruCache<K, V, Policy, Hash, KeyEqual>::touch(size_t i) {
+    uint32_t ref = table_[i].ref;
+    list_type &list = lists_[ref & 1];
+    if (Policy == cachePolicy::LRU || (ref & 1)){
+        list.splice(list.begin(), list.at(ref >> 1));
+        return;
+    }
+
+    auto it = lists_[0].at(ref >> 1);                       // promote from probation
+    table_[i].ref = lists_[1].emplace(lists_[1].begin(), std::move(*it)).id() << 1 | 1;
+    lists_[0].erase(it);
+    if (lists_[1].size() <= protected_capacity_)
+        return;
+
+    Entry &last = lists_[1].back();                         // demote the least recent protected entry
+    size_t j = find(last.key, hash(last.key));
+    table_[j].ref = lists_[0].emplace(lists_[0].begin(), std::move(last)).id() << 1;
+    lists_[1].erase(std::prev(lists_[1].end()));
+}
+
+template<typename K, typename V, cachePolicy Policy, class Hash, class KeyEqual>
+void lruCache<K, V, Policy, Hash, KeyEqual>::evict() {
+    list_type &list = lists_[lists_[0].size() ? 0 : 1];
+    auto last = std::prev(list.end());
+    erase_slot(find(last->key, hash(last->key)));
+    list.erase(last);
+    ++stats_.evictions;
+}
+
+template<typename K, typename V, cachePolicy Policy, class Hash, class KeyEqual>
+V* lruCache<K, V, Policy, Hash, KeyEqual>::get(const K &key) {
+    size_t i = find(key, hash(key));
+    if (table_[i].ref == EMPTY){
+        ++stats_.misses;
+        return nullptr;
+    }
+    ++stats_.hits;
+    touch(i);
+    return &entry(table_[i].ref).val;
+}
+
+template<typename K, typename V, cachePolicy Policy, class Hash, class KeyEqual>
+bool lruCache<K, V, Policy, Hash, KeyEqual>::put(const K &key, const V &val) {
+    uint32_t h = hash(key);
+    size_t i = find(key, h);
+    if (table_[i].ref != EMPTY){
+        touch(i);
+        entry(table_[i].ref).val = val;
+        return false;
+    }
+    if (size() == capacity_){
+        evict();
+        i = find(key, h);                                   // the shift may have moved the free slot
+    }
+    table_[i] = Slot{h, lists_[0].emplace(lists_[0].begin(), Entry{key, val}).id() << 1};
+    return true;
+}
+
+template<typename K, typename V, cachePolicy Policy, class Hash, class KeyEqual>
+template<class F>
+V& lruCache<K, V, Policy, Hash, KeyEqual>::fetch(const K &key, F load) {
+    if (V *cached = get(key))
+        return *cached;
+    put(key, load(key));
+    return lists_[0].front().val;
+}
+
+template<typename K, typename V, cachePolicy Policy, class Hash, class KeyEqual>
+bool lruCache<K, V, Policy, Hash, KeyEqual>::erase(const K &key) {
+    size_t i = find(key, hash(key));
+    uint32_t ref = table_[i].ref;
+    if (ref == EMPTY)
+        return false;
+    erase_slot(i);
+    lists_[ref & 1].erase(lists_[ref & 1].at(ref >> 1));
+    return true;
+}
+
+template<typename K, typename V, cachePolicy Policy, class Hash, class KeyEqual>
+bool lruCache<K, V, Policy, Hash, KeyEqual>::contains(const K &key) const {
+    return table_[find(key, hash(key))].ref != EMPTY;
+}
+
+template<typename K, typename V, cachePolicy Policy, class Hash, class KeyEqual>
+template<class F>
+void lruCache<K, V, Policy, Hash, KeyEqual>::for_each(F f) const {
+    for (const Entry &e : lists_[1])
+        f(e.key, e.val);
+    for (const Entry &e : lists_[0])
+        f(e.key, e.val);
+}
+
+template<typename K, typename V, cachePolicy Policy, class Hash, class KeyEqual>
+void lruCache<K, V, Policy, Hash, KeyEqual>::dump(std::ostream &out) const {
+    out << "size = " << size() << " / " << capacity_ << ", table = " << table_.size() << '\n';
+    out << "hits = " << stats_.hits << ", misses = " << stats_.misses << ", evictions = " << stats_.evictions << '\n';
+    for_each([&](const K &key, const V &val){ out << "( " << key << " : " << val << " ) "; });
+    out << '\n';
+}
+
+#endif
@@ -0,0 +1,172 @@
+#include "lrucache.hpp"
+
+#include <random>
+#include <list>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "gtest/gtest.h"
+
+
+std::mt19937 rnd(179);
+
+// The node-based cache it replaces, with the same segment rules
+struct ReferenceCache{
+    size_t capacity, protected_capacity;
+    std::list<std::pair<int, int>> lists[2];
+    std::unordered_map<int, std::pair<int, std::list<std::pair<int, int>>::iterator>> index;
+    uint64_t evictions = 0;
+
+    void touch( int key ) {
+        auto &[segment, it] = index[key];
+        if (!protected_capacity || segment){
+            lists[segment].splice(lists[segment].begin(), lists[segment], it);
+            return;
+        }
+        lists[1].splice(lists[1].begin(), lists[0], it);
+        segment = 1;
+        if (lists[1].size() > protected_capacity){
+            auto last = std::prev(lists[1].end());
+            lists[0].splice(lists[0].begin(), lists[1], last);
+            index[last->first].first = 0;
+        }
+    }
+
+    int *get( int key ) {
+        if (!index.count(key))
+            return nullptr;
+        touch(key);
+        return &index[key].second->second;
+    }
+
+    void put( int key, int val ) {
+        if (index.count(key)){
+            touch(key);
+            index[key].second->second = val;
+            return;
+        }
+        if (index.size() == capacity){
+            auto &list = lists[lists[0].size() ? 0 : 1];
+            index.erase(list.back().first);
+            list.pop_back();
+            ++evictions;
+        }
+        lists[0].push_front({key, val});
+        index[key] = {0, lists[0].begin()};
+    }
+
+    void erase( int key ) {
+        auto found = index.find(key);
+        lists[found->second.first].erase(found->second.second);
+        index.erase(found);
+    }
+
+    std::vector<std::pair<int, int>> contents() const {
+        std::vector<std::pair<int, int>> result(lists[1].begin(), lists[1].end());
+        result.insert(result.end(), lists[0].begin(), lists[0].end());
+        return result;
+    }
+};
+
+template<cachePolicy Policy>
+void RandomOpsTest( size_t capacity, int keys )
+{
+    lruCache<int, int, Policy> C(capacity);
+    ReferenceCache R{capacity, Policy == cachePolicy::SLRU ? capacity * 4 / 5 : 0};
+    uint64_t hits = 0, misses = 0;
+
+    for (int step = 0; step < 20000; ++step){
+        int key = rnd() % keys;
+        switch (rnd() % 8){
+        case 0:
+            EXPECT_EQ(C.erase(key), R.index.count(key) == 1);
+            if (R.index.count(key))
+                R.erase(key);
+            break;
+        case 1:
+        case 2:
+        case 3:
+            EXPECT_EQ(C.put(key, step), !R.index.count(key));
+            R.put(key, step);
+            break;
+        default:
+            int *expected = R.get(key);
+            int *got = C.get(key);
+            ASSERT_EQ(got == nullptr, expected == nullptr);
+            if (got){
+                EXPECT_EQ(*got, *expected);
+                ++hits;
+            }
+            else
+                ++misses;
+        }
+        ASSERT_EQ(C.size(), R.index.size());
+        EXPECT_EQ(C.contains(key), R.index.count(key) == 1);
+    }
+
+    std::vector<std::pair<int, int>> contents;
+    C.for_each([&](int key, int val){ contents.push_back({key, val}); });
+    EXPECT_EQ(contents, R.contents());
+    EXPECT_EQ(C.stats().hits, hits);
+    EXPECT_EQ(C.stats().misses, misses);
+    EXPECT_EQ(C.stats().evictions, R.evictions);
+}
+
+TEST(LRU, randomOps){
+    for (size_t capacity : {1, 2, 7, 64, 1000})
+        RandomOpsTest<cachePolicy::LRU>(capacity, 200);
+}
+
+TEST(SLRU, randomOps){
+    for (size_t capacity : {1, 2, 7, 64, 1000})
+        RandomOpsTest<cachePolicy::SLRU>(capacity, 200);
+}
+
+TEST(LRU, fetchAndStrings){
+    lruCache<std::string, size_t> C(3);
+    size_t loads = 0;
+    auto load = [&](const std::string &key){ ++loads; return key.size(); };
+
+    EXPECT_EQ(C.fetch("a", load), 1);
+    EXPECT_EQ(C.fetch("bb", load), 2);
+    EXPECT_EQ(C.fetch("a", load), 1);
+    EXPECT_EQ(C.fetch("ccc", load), 3);
+    EXPECT_EQ(C.fetch("dddd", load), 4);                    // evicts "bb", the least recent
+    EXPECT_EQ(loads, 4);
+    EXPECT_FALSE(C.contains("bb"));
+    EXPECT_TRUE(C.contains("a"));
+    EXPECT_EQ(C.stats().hits, 1);
+    EXPECT_EQ(C.stats().misses, 4);
+    EXPECT_EQ(C.stats().evictions, 1);
+
+    C.reset_stats();
+    EXPECT_EQ(C.stats().misses, 0);
+}
+
+TEST(SLRU, scanResistance){
+    lruCache<int, int, cachePolicy::LRU>  L(100);
+    lruCache<int, int, cachePolicy::SLRU> S(100);
+    for (int rep = 0; rep < 2; ++rep)                       // hot keys are hit twice, so SLRU protects them
+        for (int key = 0; key < 50; ++key){
+            if (!L.get(key)) L.put(key, key);
+            if (!S.get(key)) S.put(key, key);
+        }
+    for (int key = 1000; key < 2000; ++key){                // a one-off scan
+        L.put(key, key);
+        S.put(key, key);
+    }
+    L.reset_stats();
+    S.reset_stats();
+    for (int key = 0; key < 50; ++key){
+        L.get(key);
+        S.get(key);
+    }
+    EXPECT_EQ(L.stats().hits, 0);
+    EXPECT_EQ(S.stats().hits, 50);
+}
+
+
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,51 @@
+#include "slidingwindow.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+
+std::mt19937 rnd(179);
+
+int main()
+{
+    const size_t events = 2000000;
+    std::vector<double> stream(events);
+    for (auto &elem : stream)
+        elem = static_cast<double>(rnd() % 100000);
+
+    for (size_t len : {16, 256, 4096}){
+        double check_naive = 0, check_window = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < events; ++i){
+            size_t from = i + 1 > len ? i + 1 - len : 0;
+            double mn = stream[from], mx = stream[from], sum = 0;
+            for (size_t j = from; j <= i; ++j){
+                mn = std::min(mn, stream[j]);
+                mx = std::max(mx, stream[j]);
+                sum += stream[j];
+            }
+            check_naive += mn + mx + sum;
+        }
+        auto naive = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        slidingWindow<double> W(len);
+        for (size_t i = 0; i < events; ++i){
+            W.push(stream[i]);
+            check_window += W.min() + W.max() + W.sum();
+        }
+        auto window = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        slidingWindow<double> B(len);
+        for (size_t i = 0; i < events; i += 64)
+            B.push_n(stream.data() + i, std::min<size_t>(64, events - i));
+        auto batched = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "window " << len << ":  rescan " << naive << "s,  slidingWindow " << window
+                  << "s,  push_n(64) " << batched << "s  (checksum diff " << check_naive - check_window << ")\n";
+    }
+}
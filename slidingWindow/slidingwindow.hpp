@@ -0,0 +1,193 @@
+#ifndef SLIDINGWINDOW_HPP
+#define SLIDINGWINDOW_HPP
+
+#include <iostream>
+#include <cassert>
+#include <type_traits>
+
+#include "../deque/deque.hpp"
+
+
+//==========================================
+// Sliding window aggregator
+//
+// min/max are kept in monotonic deques of (seq, value) entries, sum is a running
+// total (Kahan-compensated for floating point T); push/evict are amortized O(1),
+// every query is O(1).
+
+enum class window_kind { count, time };
+
+template<typename T, typename Stamp = long long>
+class slidingWindow {
+private:
+    struct Entry{
+        size_t seq;                 // number of the element in the stream
+        T val;
+
+        friend std::ostream& operator<<( std::ostream &out, const Entry &e ) { return out << e.seq << ": " << e.val; }
+    };
+
+    window_kind kind_;
+    size_t count_;              // window length for window_kind::count
+    Stamp  span_;               // window length for window_kind::time: live stamps are in (now - span_, now]
+
+    deque<T>     values_;       // live elements, needed to take them out of the sum
+    deque<Stamp> stamps_;       // stamps of live elements, used only by window_kind::time
+    deque<Entry> min_;          // values increase from front to back
+    deque<Entry> max_;          // values decrease from front to back
+
+    size_t head_seq_;           // seq of the oldest live element
+    size_t next_seq_;           // seq of the next pushed element
+
+    T sum_;
+    T comp_;                    // Kahan compensation, stays zero for integral T
+
+    void add( const T &val );
+    void evict_front();
+
+public:
+
+    //===========================================
+    // Interface functions
+
+    slidingWindow( size_t count );
+    slidingWindow( window_kind kind, Stamp span );
+
+    void push( const T &val, Stamp stamp = Stamp() );
+    void push_n( const T *vals, size_t n, const Stamp *stamps = nullptr );      // stamps are ignored for window_kind::count
+
+    void evict( Stamp now );                                                    // drop everything older than now - span
+
+    const T& min() const { assert(min_.size()); return min_.front().val; }
+    const T& max() const { assert(max_.size()); return max_.front().val; }
+    T        sum() const { return sum_; }
+
+    size_t size() const { return values_.size(); }
+    bool  empty() const { return !values_.size(); }
+
+    void clear();
+};
+
+
+template<typename T, typename Stamp>
+slidingWindow<T, Stamp>::slidingWindow( size_t count )
+    : kind_(window_kind::count), count_(count), span_(), head_seq_(0), next_seq_(0), sum_(), comp_() {
+
+    assert(count);
+}
+
+
+template<typename T, typename Stamp>
+slidingWindow<T, Stamp>::slidingWindow( window_kind kind, Stamp span )
+    : kind_(kind), count_(-1), span_(span), head_seq_(0), next_seq_(0), sum_(), comp_() {
+
+    if (kind_ == window_kind::count){
+        assert(span > 0);
+        count_ = static_cast<size_t>(span);
+    }
+}
+
+
+template<typename T, typename Stamp>
+void slidingWindow<T, Stamp>::add( const T &val ) {
+    if constexpr (std::is_floating_point_v<T>){
+        T y = val - comp_;
+        T t = sum_ + y;
+        comp_ = (t - sum_) - y;
+        sum_ = t;
+    }
+    else
+        sum_ += val;
+}
+
+
+template<typename T, typename Stamp>
+void slidingWindow<T, Stamp>::evict_front() {
+    assert(values_.size());
+    T val = values_.pop_front();
+    if (kind_ == window_kind::time)
+        stamps_.pop_front();
+    add(-val);
+
+    if (min_.size() && min_.front().seq == head_seq_)
+        min_.pop_front();
+    if (max_.size() && max_.front().seq == head_seq_)
+        max_.pop_front();
+    ++head_seq_;
+
+    if (!values_.size()){
+        sum_ = T();                 // no drift survives an empty window
+        comp_ = T();
+    }
+}
+
+
+template<typename T, typename Stamp>
+void slidingWindow<T, Stamp>::push( const T &val, Stamp stamp ) {
+    if (kind_ == window_kind::time){
+        assert(!stamps_.size() || stamps_.back() <= stamp);
+        stamps_.push_back(stamp);
+    }
+    values_.push_back(val);
+    add(val);
+
+    while (min_.size() && !(min_.back().val < val))
+        min_.pop_back();
+    min_.push_back({next_seq_, val});
+
+    while (max_.size() && !(val < max_.back().val))
+        max_.pop_back();
+    max_.push_back({next_seq_, val});
+
+    ++next_seq_;
+
+    if (kind_ == window_kind::count){
+        if (values_.size() > count_)
+            evict_front();
+    }
+    else
+        evict(stamp);
+}
+
+
+template<typename T, typename Stamp>
+void slidingWindow<T, Stamp>::push_n( const T *vals, size_t n, const Stamp *stamps ) {
+    if (kind_ == window_kind::count && n >= count_){
+        // the whole window is replaced: skip the prefix that would be evicted anyway
+        next_seq_ += n - count_;
+        clear();
+        vals += n - count_;
+        n = count_;
+    }
+    if (kind_ == window_kind::time){
+        assert(stamps);
+        for (size_t i = 0; i < n; ++i)
+            push(vals[i], stamps[i]);
+        return;
+    }
+    for (size_t i = 0; i < n; ++i)
+        push(vals[i]);
+}
+
+
+template<typename T, typename Stamp>
+void slidingWindow<T, Stamp>::evict( Stamp now ) {
+    assert(kind_ == window_kind::time);
+    while (stamps_.size() && !(now - span_ < stamps_.front()))
+        evict_front();
+}
+
+
+template<typename T, typename Stamp>
+void slidingWindow<T, Stamp>::clear() {
+    values_ = deque<T>();
+    stamps_ = deque<Stamp>();
+    min_    = deque<Entry>();
+    max_    = deque<Entry>();
+    head_seq_ = next_seq_;
+    sum_  = T();
+    comp_ = T();
+}
+
+
+#endif
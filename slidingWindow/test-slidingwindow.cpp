@@ -0,0 +1,109 @@
+#include "slidingwindow.hpp"
+
+#include <random>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include "gtest/gtest.h"
+
+
+std::mt19937 rnd(179);
+
+template<typename T>
+void CountWindowTest()
+{
+    size_t len = rnd() % 50 + 1;
+    slidingWindow<T> W(len);
+    std::vector<T> V;
+    for (int i = 0; i < rnd() % 2000 + 100; ++i){
+        T a = static_cast<T>(rnd() % 1000);
+        W.push(a);
+        V.push_back(a);
+        size_t from = V.size() > len ? V.size() - len : 0;
+        EXPECT_EQ(W.size(), V.size() - from);
+        EXPECT_EQ(W.min(), *std::min_element(V.begin() + from, V.end()));
+        EXPECT_EQ(W.max(), *std::max_element(V.begin() + from, V.end()));
+        EXPECT_EQ(W.sum(), std::accumulate(V.begin() + from, V.end(), T()));
+    }
+}
+
+template<typename T>
+void PushNTest()
+{
+    size_t len = rnd() % 50 + 1;
+    slidingWindow<T> W1(len), W2(len);
+    for (int i = 0; i < 200; ++i){
+        std::vector<T> batch(rnd() % 100);
+        for (auto &elem : batch)
+            elem = static_cast<T>(rnd() % 1000);
+        W1.push_n(batch.data(), batch.size());
+        for (auto elem : batch)
+            W2.push(elem);
+        EXPECT_EQ(W1.size(), W2.size());
+        if (!W1.empty()){
+            EXPECT_EQ(W1.min(), W2.min());
+            EXPECT_EQ(W1.max(), W2.max());
+            EXPECT_EQ(W1.sum(), W2.sum());
+        }
+    }
+}
+
+
+TEST(Basics, CountWindow)
+{
+    for (int p = 0; p < 5; ++p){
+        CountWindowTest<int>();
+        CountWindowTest<long>();
+        CountWindowTest<unsigned long long>();
+        CountWindowTest<double>();
+    }
+}
+
+TEST(Basics, PushN)
+{
+    for (int p = 0; p < 5; ++p){
+        PushNTest<int>();
+        PushNTest<long long>();
+        PushNTest<double>();
+    }
+}
+
+TEST(Basics, TimeWindow)
+{
+    for (int p = 0; p < 5; ++p){
+        long long span = rnd() % 100 + 1, now = 0;
+        slidingWindow<long long> W(window_kind::time, span);
+        std::vector<std::pair<long long, long long>> V;
+        for (int i = 0; i < 2000; ++i){
+            now += rnd() % 10;
+            long long a = rnd() % 1000;
+            W.push(a, now);
+            V.push_back({now, a});
+            std::vector<long long> live;
+            for (auto [t, v] : V)
+                if (now - span < t)
+                    live.push_back(v);
+            EXPECT_EQ(W.size(), live.size());
+            EXPECT_EQ(W.min(), *std::min_element(live.begin(), live.end()));
+            EXPECT_EQ(W.max(), *std::max_element(live.begin(), live.end()));
+            EXPECT_EQ(W.sum(), std::accumulate(live.begin(), live.end(), 0ll));
+        }
+        W.evict(now + span);
+        EXPECT_TRUE(W.empty());
+        EXPECT_EQ(W.sum(), 0);
+    }
+}
+
+TEST(Basics, KahanSum)
+{
+    slidingWindow<double> W(1000);
+    for (int i = 0; i < 100000; ++i)
+        W.push(i % 2 ? 1e8 : 1e-8);
+    EXPECT_NEAR(W.sum(), 500 * 1e8 + 500 * 1e-8, 1e-6);
+}
+
+
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
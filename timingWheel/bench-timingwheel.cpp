@@ -0,0 +1,86 @@
+#include "timingwheel.hpp"
+#include "../treap/treap.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+
+std::mt19937 rnd(179);
+
+// Steady state of LIVE timers: every tick the expired ones are rescheduled and
+// a part of the live ones is cancelled and scheduled again.
+
+const size_t   LIVE     = 1000000;
+const uint64_t HORIZON  = 1 << 16;
+const size_t   TICKS    = 1 << 14;
+const size_t   CANCELS  = 32;          // per tick
+
+double bench_wheel(size_t &ops)
+{
+    timingWheel<size_t> W;
+    std::vector<timingWheel<size_t>::handle_t> handles(LIVE);
+    for (size_t i = 0; i < LIVE; ++i)
+        handles[i] = W.schedule(rnd() % HORIZON + 1, i);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < TICKS; ++t){
+        std::vector<size_t> fired;
+        ops += W.advance(1, [&](auto, size_t &i){ fired.push_back(i); });
+        for (size_t i : fired)
+            handles[i] = W.schedule(rnd() % HORIZON + 1, i);
+        for (size_t c = 0; c < CANCELS; ++c){
+            size_t i = rnd() % LIVE;
+            if (W.cancel(handles[i]))
+                handles[i] = W.schedule(rnd() % HORIZON + 1, i);
+            ops += 2;
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double bench_treap(size_t &ops)
+{
+    // key = deadline << 20 | timer id keeps keys unique while ids stay below 2^20
+    Treap<uint64_t, size_t> T;
+    std::vector<uint64_t> keys(LIVE);
+    uint64_t now = 0;
+    for (size_t i = 0; i < LIVE; ++i){
+        keys[i] = ((now + rnd() % HORIZON + 1) << 20) | i;
+        T.insert(keys[i], i);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < TICKS; ++t){
+        ++now;
+        std::vector<size_t> fired;
+        while (T.size() && ((*T.begin()).first >> 20) <= now){
+            auto [key, i] = *T.begin();
+            fired.push_back(i);
+            T.erase(key);
+            ++ops;
+        }
+        for (size_t i : fired){
+            keys[i] = ((now + rnd() % HORIZON + 1) << 20) | i;
+            T.insert(keys[i], i);
+        }
+        for (size_t c = 0; c < CANCELS; ++c){
+            size_t i = rnd() % LIVE;
+            T.erase(keys[i]);
+            keys[i] = ((now + rnd() % HORIZON + 1) << 20) | i;
+            T.insert(keys[i], i);
+            ops += 2;
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    size_t wheel_ops = 0, treap_ops = 0;
+    double wheel = bench_wheel(wheel_ops);
+    double treap = bench_treap(treap_ops);
+    std::cout << LIVE << " live timers, " << TICKS << " ticks\n";
+    std::cout << "timingWheel: " << wheel << "s, " << wheel_ops / wheel / 1e6 << " M expire+cancel ops/s\n";
+    std::cout << "Treap:       " << treap << "s, " << treap_ops / treap / 1e6 << " M expire+cancel ops/s\n";
+}
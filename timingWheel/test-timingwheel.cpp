@@ -0,0 +1,85 @@
+#include "timingwheel.hpp"
+
+#include <random>
+#include <map>
+#include <set>
+#include <vector>
+#include "gtest/gtest.h"
+
+
+std::mt19937 rnd(179);
+
+template<size_t SLOT_BITS, size_t LEVELS>
+void ScheduleAndExpireTest(uint64_t max_delay)
+{
+    timingWheel<int, SLOT_BITS, LEVELS> W;
+    std::multimap<uint64_t, int> M;                          // deadline -> payload
+    std::map<int, typename timingWheel<int, SLOT_BITS, LEVELS>::handle_t> H;
+    int next = 0;
+
+    for (int step = 0; step < 3000; ++step){
+        for (int i = 0; i < rnd() % 4; ++i){
+            uint64_t delay = rnd() % max_delay + 1;
+            H[next] = W.schedule(delay, next);
+            M.insert({W.now() + delay, next});
+            ++next;
+        }
+        if (H.size() && rnd() % 3 == 0){
+            auto iter = H.begin();
+            std::advance(iter, rnd() % H.size());
+            EXPECT_TRUE(W.cancel(iter->second));
+            EXPECT_FALSE(W.cancel(iter->second));
+            for (auto m = M.begin(); m != M.end(); ++m)
+                if (m->second == iter->first){
+                    M.erase(m);
+                    break;
+                }
+            H.erase(iter);
+        }
+
+        uint64_t ticks = rnd() % 5 + 1;
+        std::multiset<int> fired, expected;
+        W.advance(ticks, [&](auto handle, int &val){
+            fired.insert(val);
+            EXPECT_EQ(H[val], handle);
+            H.erase(val);
+        });
+        while (M.size() && M.begin()->first <= W.now()){
+            expected.insert(M.begin()->second);
+            M.erase(M.begin());
+        }
+        EXPECT_EQ(fired, expected);
+        EXPECT_EQ(W.size(), M.size());
+    }
+}
+
+
+TEST(Basics, ScheduleAndExpire)
+{
+    for (int p = 0; p < 3; ++p){
+        ScheduleAndExpireTest<8, 4>(100000);
+        ScheduleAndExpireTest<3, 3>(400);
+        ScheduleAndExpireTest<2, 2>(100);          // most deadlines are past the top wheel
+    }
+}
+
+TEST(Basics, RescheduleFromCallback)
+{
+    timingWheel<int, 4, 3> W;
+    for (int i = 0; i < 100; ++i)
+        W.schedule(rnd() % 1000, i);
+    size_t fired = 0;
+    for (int i = 0; i < 100; ++i)
+        fired += W.advance(100, [&](auto, int &val){
+            if (val + 100 < 1000)
+                W.schedule(rnd() % 300, val + 100);
+        });
+    EXPECT_EQ(fired, 1000);
+    EXPECT_TRUE(W.empty());
+}
+
+
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,194 @@
+#ifndef TIMINGWHEEL_HPP
+#define TIMINGWHEEL_HPP
+
+#include <iostream>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+#include "../deque/deque.hpp"
+
+
+//==========================================
+// Hierarchical timing wheel
+//
+// LEVELS wheels of 2^SLOT_BITS deque buckets each; a bucket of level l holds timers
+// whose deadline differs from now in bits [SLOT_BITS * l, SLOT_BITS * (l + 1)).
+// When the lower wheel wraps the next bucket of the upper one is cascaded down,
+// level 0 buckets are expired whole. Cancelled timers are dropped lazily: a handle
+// carries the generation of its record, so stale bucket entries are skipped.
+
+template<typename Payload, size_t SLOT_BITS = 8, size_t LEVELS = 4>
+class timingWheel {
+public:
+    using handle_t = uint64_t;                              // generation << 32 | record id
+
+    static constexpr size_t   SLOTS = size_t(1) << SLOT_BITS;
+    static constexpr size_t   MASK  = SLOTS - 1;
+
+private:
+    struct Entry{
+        uint32_t id;
+        uint32_t gen;
+
+        friend std::ostream& operator<<( std::ostream &out, const Entry &e ) { return out << e.id << '/' << e.gen; }
+    };
+
+    struct Record{
+        uint64_t deadline;
+        uint32_t gen;
+        uint32_t next;                                      // free list link, -1 terminated
+        Payload  val;
+    };
+
+    deque<Entry>        wheel_[LEVELS][SLOTS];
+    std::vector<Record> records_;
+    uint32_t            last_free_;
+    uint64_t            now_;
+    size_t              size_;                              // number of live timers
+
+    uint32_t alloc_record();
+    void     free_record( uint32_t id );
+    void     place( const Entry &e );
+    void     cascade( size_t level );
+
+    template<class F>
+    size_t   expire_bucket( deque<Entry> &bucket, F &on_expire );
+
+public:
+
+    //===========================================
+    // Interface functions
+
+    timingWheel( uint64_t now = 0 ) : last_free_(-1), now_(now), size_(0) {}
+
+    handle_t schedule( uint64_t delay, const Payload &val );    // fires after delay ticks, delay 0 means the next tick
+    bool     cancel( handle_t handle );                         // false if the timer already fired or was cancelled
+
+    template<class F>
+    size_t   advance( uint64_t ticks, F on_expire );            // on_expire(handle, Payload&) for every fired timer, returns their count
+
+    uint64_t now()  const { return now_; }
+    size_t   size() const { return size_; }
+    bool     empty() const { return !size_; }
+};
+
+
+template<typename Payload, size_t SLOT_BITS, size_t LEVELS>
+uint32_t timingWheel<Payload, SLOT_BITS, LEVELS>::alloc_record() {
+    if (last_free_ != uint32_t(-1)){
+        uint32_t id = last_free_;
+        last_free_ = records_[id].next;
+        return id;
+    }
+    records_.push_back(Record{0, 0, uint32_t(-1), Payload()});
+    return static_cast<uint32_t>(records_.size() - 1);
+}
+
+
+template<typename Payload, size_t SLOT_BITS, size_t LEVELS>
+void timingWheel<Payload, SLOT_BITS, LEVELS>::free_record( uint32_t id ) {
+    Record &r = records_[id];
+    ++r.gen;                                                // invalidates the handle and the bucket entry
+    r.next = last_free_;
+    last_free_ = id;
+    --size_;
+}
+
+
+template<typename Payload, size_t SLOT_BITS, size_t LEVELS>
+void timingWheel<Payload, SLOT_BITS, LEVELS>::place( const Entry &e ) {
+    uint64_t deadline = records_[e.id].deadline;
+    uint64_t diff = deadline - now_;
+    size_t level = 0;
+    while (level + 1 < LEVELS && diff >= (uint64_t(1) << (SLOT_BITS * (level + 1))))
+        ++level;
+    // deadlines beyond the top wheel land in the slot of their bits and are cascaded again until they fit
+    wheel_[level][(deadline >> (SLOT_BITS * level)) & MASK].push_back(e);
+}
+
+
+template<typename Payload, size_t SLOT_BITS, size_t LEVELS>
+typename timingWheel<Payload, SLOT_BITS, LEVELS>::handle_t
+timingWheel<Payload, SLOT_BITS, LEVELS>::schedule( uint64_t delay, const Payload &val ) {
+    if (!delay)
+        delay = 1;
+    uint32_t id = alloc_record();
+    Record &r = records_[id];
+    r.deadline = now_ + delay;
+    r.val = val;
+    ++size_;
+
+    place({id, r.gen});
+    return (handle_t(r.gen) << 32) | id;
+}
+
+
+template<typename Payload, size_t SLOT_BITS, size_t LEVELS>
+bool timingWheel<Payload, SLOT_BITS, LEVELS>::cancel( handle_t handle ) {
+    uint32_t id  = static_cast<uint32_t>(handle);
+    uint32_t gen = static_cast<uint32_t>(handle >> 32);
+    if (id >= records_.size() || records_[id].gen != gen)
+        return false;
+    free_record(id);
+    return true;
+}
+
+
+template<typename Payload, size_t SLOT_BITS, size_t LEVELS>
+void timingWheel<Payload, SLOT_BITS, LEVELS>::cascade( size_t level ) {
+    deque<Entry> &bucket = wheel_[level][(now_ >> (SLOT_BITS * level)) & MASK];
+    if (!bucket.size())
+        return;
+
+    deque<Entry> drained(std::move(bucket));                // a far timer may be placed back into this very slot
+    for (size_t i = 0; i < drained.size(); ++i){
+        const Entry &e = drained[i];
+        if (records_[e.id].gen == e.gen)
+            place(e);
+    }
+    drained.clear();
+    if (!bucket.size())
+        bucket = std::move(drained);                        // keep the grown buffer
+}
+
+
+template<typename Payload, size_t SLOT_BITS, size_t LEVELS>
+template<class F>
+size_t timingWheel<Payload, SLOT_BITS, LEVELS>::expire_bucket( deque<Entry> &bucket, F &on_expire ) {
+    size_t fired = 0;
+    for (size_t i = 0; i < bucket.size(); ++i){
+        Entry e = bucket[i];
+        Record &r = records_[e.id];
+        if (r.gen != e.gen)
+            continue;
+        assert(r.deadline == now_);
+        Payload val = std::move(r.val);                     // on_expire may schedule and reallocate records_
+        free_record(e.id);
+        on_expire((handle_t(e.gen) << 32) | e.id, val);
+        ++fired;
+    }
+    bucket.clear();
+    return fired;
+}
+
+
+template<typename Payload, size_t SLOT_BITS, size_t LEVELS>
+template<class F>
+size_t timingWheel<Payload, SLOT_BITS, LEVELS>::advance( uint64_t ticks, F on_expire ) {
+    size_t fired = 0;
+    for (uint64_t t = 0; t < ticks; ++t){
+        ++now_;
+        for (size_t level = 1; level < LEVELS && !((now_ >> (SLOT_BITS * (level - 1))) & MASK); ++level)
+            cascade(level);
+
+        deque<Entry> &bucket = wheel_[0][now_ & MASK];
+        if (bucket.size())
+            fired += expire_bucket(bucket, on_expire);
+    }
+    return fired;
+}
+
+
+#endif
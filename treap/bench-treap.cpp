@@ -0,0 +1,180 @@
+#include "treap.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <thread>
+
+
+double since( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<class Priority>
+void bench_insert_erase( const char *name, size_t n )
+{
+    std::mt19937 gen(1);
+    std::vector<int> keys(n);
+    for (auto &key : keys)
+        key = static_cast<int>(gen());
+
+    Treap<int, int, uint32_t, Priority> T;
+    auto start = std::chrono::steady_clock::now();
+    for (int key : keys)
+        T.insert(key, key);
+    double insert = since(start);
+
+    start = std::chrono::steady_clock::now();
+    long long check = 0;
+    for (int key : keys)
+        check += *T.find(key);
+    double find = since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int key : keys)
+        T.erase(key);
+    double erase = since(start);
+
+    std::cout << n << " random keys, " << name << ", ns per operation:  insert " << insert / n * 1e9 << ",  find " << find / n * 1e9
+              << ",  erase " << erase / n * 1e9 << "  (checksum " << check << ", left " << T.size() << ")\n";
+}
+
+void bench_build( size_t n )
+{
+    std::mt19937 gen(2);
+    std::vector<std::pair<int, int>> items(n);
+    for (auto &[key, val] : items)
+        key = val = static_cast<int>(gen());
+    auto sorted = items;
+    std::sort(sorted.begin(), sorted.end());
+
+    Treap<int, int> A, B, C, D;
+    auto start = std::chrono::steady_clock::now();
+    for (auto [key, val] : sorted)
+        A.insert(key, val);
+    double insert_sorted = since(start);
+    start = std::chrono::steady_clock::now();
+    B.build_sorted(sorted.begin(), sorted.end());
+    double build_sorted = since(start);
+    start = std::chrono::steady_clock::now();
+    for (auto [key, val] : items)
+        C.insert(key, val);
+    double insert_random = since(start);
+    start = std::chrono::steady_clock::now();
+    D.build_unsorted(items.begin(), items.end());
+    double build_unsorted = since(start);
+
+    std::cout << n << " keys, s:  sorted input: insert " << insert_sorted << ", build_sorted " << build_sorted
+              << ";  random input: insert " << insert_random << ", build_unsorted " << build_unsorted
+              << "  (" << (A.size() == B.size() && C.size() == D.size() ? "same sizes" : "DIFFERENT SIZES") << ")\n";
+}
+
+// A large treap against a small one, half of whose keys it already has
+void bench_set_ops( size_t n, size_t m )
+{
+    std::mt19937 gen(3);
+    Treap<int, int> big, small;
+    std::vector<int> small_keys;
+    for (size_t i = 0; i < n; ++i)
+        big.insert(static_cast<int>(gen()), 1);
+    for (size_t i = 0; i < m; ++i){
+        int key = i % 2 ? static_cast<int>(gen()) : (*(big.begin() + gen() % big.size())).first;
+        small.insert(key, 2);
+        small_keys.push_back(key);
+    }
+
+    auto timed = [](auto job){ auto start = std::chrono::steady_clock::now(); job(); return since(start); };
+    Treap<int, int> A = big, B = big, C = big, D = big, E = small;
+    double unite = timed([&]{ A.unite(small); });
+    double insert = timed([&]{ for (int key : small_keys) B.insert(key, 2); });
+    double intersect = timed([&]{ E.intersect(std::move(C)); });
+    double subtract = timed([&]{ D.subtract(small); });
+    Treap<int, int> F = big;
+    double erase = timed([&]{ for (int key : small_keys) F.erase(key); });
+
+    std::cout << n << " and " << m << " keys, us:  unite " << unite * 1e6 << " (insert loop " << insert * 1e6 << "),  intersect "
+              << intersect * 1e6 << ",  subtract " << subtract * 1e6 << " (erase loop " << erase * 1e6 << ")"
+              << "  (" << (A.size() == B.size() && D.size() == F.size() ? "same sizes" : "DIFFERENT SIZES") << ", " << E.size() << " common)\n";
+}
+
+// The same operations on one thread and on all cores
+void bench_parallel( size_t n )
+{
+    std::mt19937 gen(4);
+    std::vector<std::pair<int, int>> items_1(n), items_2(n);
+    for (auto &[key, val] : items_1)
+        key = val = static_cast<int>(gen() % (4 * n));
+    for (auto &[key, val] : items_2)
+        key = val = static_cast<int>(gen() % (4 * n));
+    Treap<int, int> T1, T2;
+    T1.build_unsorted(items_1.begin(), items_1.end());
+    T2.build_unsorted(items_2.begin(), items_2.end());
+
+    std::cout << n << " and " << n << " keys, s, 1 thread / " << std::thread::hardware_concurrency() << ":";
+    for (size_t threads : {1, 0}){
+        auto timed = [](auto job){ auto start = std::chrono::steady_clock::now(); job(); return since(start); };
+        Treap<int, int> A = T1, B = T1, C = T1, D = T1;
+        double unite = timed([&]{ A.unite(T2, takeOther(), threads); });
+        double intersect = timed([&]{ B.intersect(T2, takeOther(), threads); });
+        double subtract = timed([&]{ C.subtract(T2, threads); });
+        double filter = timed([&]{ D.filter([](int key, int){ return key % 2; }, threads); });
+        std::cout << "  unite " << unite << ", intersect " << intersect << ", subtract " << subtract << ", filter " << filter
+                  << (threads ? "  /" : "") << (A.size() + B.size() + C.size() + D.size() ? "" : " EMPTY");
+    }
+    std::cout << '\n';
+}
+
+// Range sums from the aggregates against walking the range, and what keeping them costs inserts
+void bench_aggregate( size_t n, size_t span )
+{
+    std::mt19937 gen(5);
+    std::vector<int> keys(n);
+    for (auto &key : keys)
+        key = static_cast<int>(gen() % (4 * n));
+
+    auto timed = [](auto job){ auto start = std::chrono::steady_clock::now(); job(); return since(start); };
+    Treap<int, int> P;
+    Treap<int, int, uint32_t, xorshiftPriority, sumAggregate<long long>> S;
+    double insert_plain = timed([&]{ for (int key : keys) P.insert(key, key % 100); });
+    double insert_summed = timed([&]{ for (int key : keys) S.insert(key, key % 100); });
+
+    const size_t QUERIES = 100000;
+    long long check_1 = 0, check_2 = 0;
+    double walk = timed([&]{
+        for (size_t q = 0; q < QUERIES / 100; ++q){             // 100 times fewer, it is slow
+            int lo = static_cast<int>(keys[q]), hi = lo + static_cast<int>(4 * span);
+            size_t i = P.count(0, lo - 1);
+            for (auto it = P.begin() + i; it != P.end() && (*it).first <= hi; ++it)
+                check_1 += (*it).second;
+        }
+    }) * 100;
+    double aggregate = timed([&]{
+        for (size_t q = 0; q < QUERIES; ++q){
+            int lo = static_cast<int>(keys[q % n]), hi = lo + static_cast<int>(4 * span);
+            long long sum = S.aggregate(lo, hi);
+            if (q < QUERIES / 100)
+                check_2 += sum;
+        }
+    });
+    std::cout << n << " keys, ns per insert: plain " << insert_plain / n * 1e9 << ", with sums " << insert_summed / n * 1e9
+              << ";  ns per sum over ~" << span << " keys: walk " << walk / QUERIES * 1e9 << ", aggregate " << aggregate / QUERIES * 1e9
+              << "  (" << (check_1 == check_2 ? "same sums" : "DIFFERENT SUMS") << ")\n";
+}
+
+int main()
+{
+    for (size_t n : {100000, 1000000, 10000000}){
+        bench_insert_erase<xorshiftPriority>("xorshift", n);
+        bench_insert_erase<hashPriority<>>("key hash", n);
+    }
+    for (size_t n : {1000000, 10000000})
+        bench_build(n);
+    for (size_t m : {100, 10000, 1000000})
+        bench_set_ops(1000000, m);
+    bench_parallel(10000000);
+    for (size_t span : {10, 1000, 100000})
+        bench_aggregate(1000000, span);
+}
@@ -1,8 +1,17 @@
 #include "treap.hpp"
 #include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <random>
+#include <thread>
+#include <limits>
 #include "gtest/gtest.h"
 
 
+std::mt19937 rnd(179);
+
+
 template<typename T>
 void IteratorsTest(){
     Treap<int, T> T1;
@@ -122,6 +131,486 @@ TEST(Basics, CopyMove)
     }
 }
 
+TEST(Basics, ReuseErasedNodes)
+{
+    Treap<int, int> T1;
+    std::set<int> S1;
+    for (int i = 0; i < 20000; ++i){
+        int a = rnd() % 1000;
+        if (rnd() % 2){
+            T1.insert(a, a);
+            S1.insert(a);
+        }
+        else {
+            T1.erase(a);
+            S1.erase(a);
+        }
+    }
+    ASSERT_EQ(T1.size(), S1.size());
+    auto iter = T1.begin();
+    for (int elem : S1){
+        EXPECT_EQ((*iter).first, elem);
+        ++iter;
+    }
+}
+
+
+TEST(Basics, NarrowIndex)
+{
+    Treap<int, int, uint16_t> T1;
+    std::set<int> S1;
+    for (int i = 0; i < 2000; ++i){
+        int a = rnd() % 60000;
+        T1.insert(a, a);
+        S1.insert(a);
+    }
+    ASSERT_EQ(T1.size(), S1.size());
+    auto iter = T1.begin();
+    for (int elem : S1){
+        EXPECT_EQ((*iter).first, elem);
+        ++iter;
+    }
+}
+
+
+TEST(Basics, SortedInsertAndErase)
+{
+    Treap<int, int> T1;
+    for (int i = 0; i < 2000; ++i)
+        T1.insert(i, -i);
+    T1.erase(5000);                                 // missing keys leave the tree alone
+    ASSERT_EQ(T1.size(), 2000);
+    for (int i = 0; i < 2000; i += 3)
+        T1.erase(i);
+    ASSERT_EQ(T1.size(), 1333);
+    for (size_t i = 0; i < T1.size(); ++i)
+        EXPECT_EQ((*(T1.begin() + i)).first, int(i / 2 * 3 + i % 2 + 1));
+    for (int i = 1999; i >= 0; --i)
+        T1.erase(i);
+    EXPECT_EQ(T1.size(), 0);
+    EXPECT_TRUE(T1.begin() == T1.end());
+}
+
+
+TEST(Basics, InsertUpdatesExisting)
+{
+    Treap<int, int> T1;
+    std::map<int, int> M1;
+    std::map<int, int*> P1;
+    for (int i = 0; i < 2000; ++i){
+        int a = rnd() % 500, b = rnd();
+        if (rnd() % 2){
+            T1.insert(a, b);
+            M1[a] = b;
+        }
+        else {
+            int *q = T1.insert(a);
+            M1.insert({a, 0});
+            EXPECT_EQ(*q, M1[a]);
+            if (P1.count(a)){
+                EXPECT_EQ(q, P1[a]);                    // an existing node is found, not recreated
+            }
+            P1[a] = q;
+        }
+    }
+    ASSERT_EQ(T1.size(), M1.size());
+    auto iter = T1.begin();
+    for (auto [key, val] : M1){
+        EXPECT_EQ((*iter).first, key);
+        EXPECT_EQ((*iter).second, val);
+        ++iter;
+    }
+}
+
+
+template<class Priority>
+void RandomOpsTest(Treap<int, int, uint32_t, Priority> &T1, std::mt19937 &gen, int ops)
+{
+    std::map<int, int> M1;
+    for (int i = 0; i < ops; ++i){
+        int a = gen() % 1000;
+        if (gen() % 3){
+            T1.insert(a, i);
+            M1[a] = i;
+        }
+        else {
+            T1.erase(a);
+            M1.erase(a);
+        }
+    }
+    ASSERT_EQ(T1.size(), M1.size());
+    auto iter = T1.begin();
+    for (auto [key, val] : M1){
+        EXPECT_EQ((*iter).first, key);
+        EXPECT_EQ((*iter).second, val);
+        ++iter;
+    }
+}
+
+TEST(Priority, HashOfKey)
+{
+    Treap<int, int, uint32_t, hashPriority<>> T1;
+    RandomOpsTest(T1, rnd, 2000);
+
+    Treap<std::string, int, uint32_t, hashPriority<>> T2;
+    for (int i = 0; i < 500; ++i)
+        T2.insert(std::to_string(i), i);
+    EXPECT_EQ(T2.size(), 500);
+    EXPECT_EQ(*T2.find("250"), 250);
+}
+
+TEST(Priority, DistinctDefaultSeeds)
+{
+    xorshiftPriority a, b, c(7), d(7);
+    bool differ = false;
+    for (int i = 0; i < 16; ++i){
+        differ |= a(i) != b(i);
+        EXPECT_EQ(c(i), d(i));
+    }
+    EXPECT_TRUE(differ);
+}
+
+TEST(Priority, OneTreapPerThread)
+{
+    std::vector<std::thread> threads;
+    for (uint64_t t = 0; t < 4; ++t)
+        threads.emplace_back([t](){
+            std::mt19937 gen(t);
+            Treap<int, int, uint32_t, xorshiftPriority> T1(xorshiftPriority(t + 1));
+            RandomOpsTest(T1, gen, 2000);
+        });
+    for (auto &thread : threads)
+        thread.join();
+}
+
+
+TEST(Build, SortedAndUnsorted)
+{
+    for (size_t n : {0, 1, 2, 100, 20000}){
+        std::vector<std::pair<int, int>> items;
+        std::map<int, int> M1;
+        for (size_t i = 0; i < n; ++i){
+            items.push_back({static_cast<int>(rnd() % (n + 1)), static_cast<int>(i)});
+            M1[items.back().first] = items.back().second;
+        }
+
+        Treap<int, int> T1, T2;
+        T1.insert(-1, -1);                              // build replaces what was there
+        T2.build_unsorted(items.begin(), items.end(), 5);
+        std::stable_sort(items.begin(), items.end(), [](auto &a, auto &b){ return a.first < b.first; });
+        T1.build_sorted(items.begin(), items.end());
+        for (auto *T : {&T1, &T2}){
+            ASSERT_EQ(T->size(), M1.size());
+            size_t i = 0;
+            for (auto [key, val] : M1){
+                EXPECT_EQ((*(T->begin() + i)).first, key);
+                EXPECT_EQ((*T)[i], val);
+                ++i;
+            }
+        }
+        if (n > 2){
+            T1.insert(-5, 5);                           // and stays an ordinary treap
+            T1.erase(items[1].first);
+            EXPECT_EQ(T1.size(), M1.size());
+            EXPECT_EQ((*T1.begin()).first, -5);
+        }
+    }
+}
+
+
+template<class T>
+std::vector<std::pair<int, int>> Contents(const T &T1)
+{
+    std::vector<std::pair<int, int>> result;
+    for (auto it = T1.begin(); it != T1.end(); ++it)
+        result.push_back({(*it).first, (*it).second});
+    return result;
+}
+
+TEST(SetAlgebra, AgainstMap)
+{
+    using pairs = std::vector<std::pair<int, int>>;
+    for (auto [n, m] : std::vector<std::pair<int, int>>{{0, 0}, {0, 50}, {300, 5}, {5, 300}, {1000, 1000}, {1500, 40}}){
+        Treap<int, int> T1, T2;
+        std::map<int, int> M1, M2;
+        int keys = 2 * std::max(n, m) + 1;
+        for (int i = 0; i < n; ++i){
+            int key = rnd() % keys;
+            T1.insert(key, i);
+            M1[key] = i;
+        }
+        for (int i = 0; i < m; ++i){
+            int key = rnd() % keys;
+            T2.insert(key, -i);
+            M2[key] = -i;
+        }
+
+        std::map<int, int> U = M1, I, D;
+        for (auto [key, val] : M2)
+            U[key] = M1.count(key) ? M1[key] + val : val;
+        for (auto [key, val] : M1){
+            if (M2.count(key))
+                I[key] = val + M2[key];
+            else
+                D[key] = val;
+        }
+
+        for (bool consume : {false, true}){
+            Treap<int, int> A = T1, B = T2;
+            if (consume){
+                A.unite(std::move(B), std::plus<int>());
+                EXPECT_EQ(B.size(), 0);
+            }
+            else
+                A.unite(B, std::plus<int>());
+            EXPECT_EQ(Contents(A), pairs(U.begin(), U.end()));
+
+            A = T1, B = T2;
+            if (consume)
+                A.intersect(std::move(B), std::plus<int>());
+            else
+                A.intersect(B, std::plus<int>());
+            EXPECT_EQ(Contents(A), pairs(I.begin(), I.end()));
+        }
+        Treap<int, int> A = T1;
+        A.subtract(T2);
+        EXPECT_EQ(Contents(A), pairs(D.begin(), D.end()));
+        EXPECT_EQ(Contents(T2), pairs(M2.begin(), M2.end()));  // only read
+
+        A.insert(-7, 7);                                // the result is an ordinary treap
+        A.erase(-7);
+        EXPECT_EQ(A.size(), D.size());
+    }
+}
+
+TEST(SetAlgebra, Policies)
+{
+    Treap<int, int> T1, T2;
+    for (int i = 0; i < 10; ++i){
+        T1.insert(i, 1);
+        T2.insert(i + 5, 2);
+    }
+    Treap<int, int> A = T1, B = T2;
+    A.unite(B);                                     // takeOther by default
+    EXPECT_EQ(A.size(), 15);
+    EXPECT_EQ(*A.find(7), 2);
+    A = T1;
+    A.unite(B, keepOwn());
+    EXPECT_EQ(*A.find(7), 1);
+    A = T1;
+    A.unite(std::move(B), keepOwn());
+    EXPECT_EQ(*A.find(7), 1);
+
+    A = T1;
+    B = T2;
+    B.insert(100, 3);
+    B.insert(101, 3);                               // B is larger and A moves into its pool
+    A.intersect(std::move(B), keepOwn());
+    EXPECT_EQ(A.size(), 5);
+    EXPECT_EQ(*A.find(7), 1);
+    EXPECT_EQ(A.find(100), nullptr);
+}
+
+
+// Big enough for the branches to fork, the results have to match the serial ones
+TEST(Parallel, SetAlgebra)
+{
+    std::vector<std::pair<int, int>> items_1, items_2;
+    for (int i = 0; i < 30000; ++i){
+        items_1.push_back({rnd() % 60000, 1});
+        items_2.push_back({rnd() % 60000, 2});
+    }
+    Treap<int, int> T1, T2;
+    T1.build_unsorted(items_1.begin(), items_1.end());
+    T2.build_unsorted(items_2.begin(), items_2.end());
+    for (size_t threads : {2, 5}){
+        Treap<int, int> A = T1, B = T1;
+        A.unite(T2, std::plus<int>());
+        B.unite(T2, std::plus<int>(), threads);
+        EXPECT_EQ(Contents(A), Contents(B));
+
+        A = T1, B = T1;
+        Treap<int, int> C = T2;
+        A.intersect(T2, keepOwn());
+        B.intersect(std::move(C), keepOwn(), threads);
+        EXPECT_EQ(Contents(A), Contents(B));
+
+        A = T1, B = T1;
+        A.subtract(T2);
+        B.subtract(T2, threads);
+        EXPECT_EQ(Contents(A), Contents(B));
+
+        A = T1;
+        C = T2;
+        A.unite(std::move(C), takeOther(), threads);
+        A.insert(-1, -1);
+        EXPECT_EQ(A.size(), Contents(B).size() + T2.size() + 1);
+    }
+}
+
+TEST(Parallel, BulkUpdates)
+{
+    using pairs = std::vector<std::pair<int, int>>;
+    for (size_t threads : {1, 4}){
+        std::vector<std::pair<int, int>> items;
+        std::map<int, int> M1;
+        for (int i = 0; i < 20000; ++i){
+            items.push_back({rnd() % 100000, i});
+            M1[items.back().first] = i;
+        }
+        Treap<int, int> T1;
+        T1.build_unsorted(items.begin(), items.end());
+
+        std::vector<std::pair<int, int>> batch;
+        for (int key = 0; key < 100000; key += 1 + rnd() % 5){
+            batch.push_back({key, -key});
+            M1[key] = -key;
+        }
+        T1.insert_sorted(batch.begin(), batch.end(), threads);
+        EXPECT_EQ(Contents(T1), pairs(M1.begin(), M1.end()));
+
+        std::vector<int> keys;
+        for (int key = 0; key < 100000; key += 1 + rnd() % 3){
+            keys.push_back(key);
+            M1.erase(key);
+        }
+        T1.erase_sorted(keys.begin(), keys.end(), threads);
+        EXPECT_EQ(Contents(T1), pairs(M1.begin(), M1.end()));
+
+        T1.filter([](int key, int val){ return (key + val) % 3 != 0; }, threads);
+        std::erase_if(M1, [](auto &item){ return (item.first + item.second) % 3 == 0; });
+        EXPECT_EQ(Contents(T1), pairs(M1.begin(), M1.end()));
+
+        T1.filter([](int, int){ return false; }, threads);
+        EXPECT_EQ(T1.size(), 0);
+        T1.insert(5, 5);
+        EXPECT_EQ(T1.size(), 1);
+    }
+}
+
+
+struct keysInOrder{                                 // not commutative, so any mix-up of the order shows
+    using value_type = std::string;
+
+    std::string lift(int key, int) const { return std::to_string(key) + ' '; }
+    std::string combine(const std::string &a, const std::string &b) const { return a + b; }
+    std::string identity() const { return ""; }
+};
+
+template<class Aggregate, class Fold>
+void CheckRanges(const Treap<int, int, uint32_t, xorshiftPriority, Aggregate> &T1, const std::map<int, int> &M1, Fold fold)
+{
+    for (int i = 0; i < 50; ++i){
+        int lo = rnd() % 1200 - 100, hi = lo + rnd() % 400 - 50;
+        auto expected = Aggregate().identity();
+        for (auto it = M1.lower_bound(lo); it != M1.end() && it->first <= hi; ++it)
+            expected = fold(expected, *it);
+        EXPECT_EQ(T1.aggregate(lo, hi), expected);
+    }
+}
+
+TEST(Aggregate, RandomOps)
+{
+    Treap<int, int, uint32_t, xorshiftPriority, sumAggregate<long long>> S1;
+    Treap<int, int, uint32_t, xorshiftPriority, minAggregate<int>> N1;
+    Treap<int, int, uint32_t, xorshiftPriority, keysInOrder> K1;
+    std::map<int, int> M1;
+    auto sum = [](long long a, std::pair<int, int> item){ return a + item.second; };
+    auto min = [](int a, std::pair<int, int> item){ return std::min(a, item.second); };
+    auto keys = [](std::string a, std::pair<int, int> item){ return a + std::to_string(item.first) + ' '; };
+
+    for (int step = 0; step < 2000; ++step){
+        int key = rnd() % 1000, val = rnd() % 2001 - 1000;
+        if (rnd() % 3){
+            S1.insert(key, val);
+            N1.insert(key, val);
+            K1.insert(key, val);
+            M1[key] = val;
+        }
+        else {
+            S1.erase(key);
+            N1.erase(key);
+            K1.erase(key);
+            M1.erase(key);
+        }
+        if (step % 100 == 0){
+            CheckRanges(S1, M1, sum);
+            CheckRanges(N1, M1, min);
+            CheckRanges(K1, M1, keys);
+        }
+    }
+    EXPECT_EQ(S1.aggregate(), S1.aggregate(-1, 1000));
+    EXPECT_EQ(S1.aggregate(10, 5), 0);
+    EXPECT_EQ(N1.aggregate(2000, 3000), std::numeric_limits<int>::max());
+}
+
+template<class T>
+concept InsertsByKey = requires(T &t){ t.insert(0); };
+
+TEST(Aggregate, ReadOnlyData)
+{
+    using Summed = Treap<int, int, uint32_t, xorshiftPriority, sumAggregate<long long>>;
+    using Plain  = Treap<int, int>;
+    static_assert( InsertsByKey<Plain>);
+    static_assert(!InsertsByKey<Summed>);
+    static_assert(std::is_same_v<decltype(std::declval<Summed&>()[0]), const int&>);
+    static_assert(std::is_same_v<decltype(std::declval<Summed&>().find(0)), const int*>);
+    static_assert(std::is_same_v<decltype((*std::declval<Summed&>().begin()).second), const int&>);
+    static_assert(std::is_same_v<decltype(std::declval<Plain&>()[0]), int&>);
+
+    Summed S1;
+    for (int i = 0; i < 100; ++i)
+        S1.insert(i, i);
+    S1.insert(50, 1000);                                // the only write, and it reaches the sums
+    EXPECT_EQ(S1.aggregate(), 4950 - 50 + 1000);
+    EXPECT_EQ(S1.aggregate(40, 60), 1050 - 50 + 1000);
+    EXPECT_EQ(S1[50], 1000);
+}
+
+TEST(Aggregate, BulkOperations)
+{
+    using Summed = Treap<int, int, uint32_t, xorshiftPriority, sumAggregate<long long>>;
+    auto sum = [](long long a, std::pair<int, int> item){ return a + item.second; };
+    std::vector<std::pair<int, int>> items_1, items_2;
+    std::map<int, int> M1, M2;
+    for (int key = 0; key < 1000; ++key){
+        if (rnd() % 2){
+            items_1.push_back({key, key});
+            M1[key] = key;
+        }
+        if (rnd() % 2){
+            items_2.push_back({key, -1});
+            M2[key] = -1;
+        }
+    }
+    Summed S1, S2;
+    S1.build_sorted(items_1.begin(), items_1.end());
+    S2.build_sorted(items_2.begin(), items_2.end());
+    CheckRanges(S1, M1, sum);
+
+    Summed U = S1;
+    U.unite(S2, std::plus<int>());
+    std::map<int, int> MU = M1;
+    for (auto [key, val] : M2)
+        MU[key] += val;
+    CheckRanges(U, MU, sum);
+
+    U.subtract(S2);
+    for (auto [key, val] : M2)
+        MU.erase(key);
+    CheckRanges(U, MU, sum);
+
+    U.filter([](int key, int){ return key % 3 != 0; });
+    std::erase_if(MU, [](auto &item){ return item.first % 3 == 0; });
+    CheckRanges(U, MU, sum);
+
+    Treap<int, int> T1;
+    T1.build_sorted(items_1.begin(), items_1.end());
+    EXPECT_EQ(T1.count(100, 199), std::distance(M1.lower_bound(100), M1.upper_bound(199)));
+    EXPECT_EQ(T1.count(-5, 5000), M1.size());
+    EXPECT_EQ(T1.count(7, 6), 0);
+}
+
 
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -3,13 +3,21 @@
 
 #include <cstdint>
 #include <cstddef>
-#include <random>
 #include <vector>
 #include <iostream>
 #include <cassert>
 #include <set>
-
-std::mt19937 rnd(179);
+#include <new>
+#include <type_traits>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <tuple>
+#include <utility>
+#include <limits>
 
 template<class T, class U = T>
 T exchange(T& obj, U&& new_value)
@@ -22,86 +30,96 @@ T exchange(T& obj, U&& new_value)
 //==================================
 // Object pool
 
-template<typename Data>
+template<typename Data, typename Index = uint32_t, size_t SLAB_BITS = 8>
 class ObjPool{
 public:
+    static constexpr Index NIL = Index(-1);
     
-    ObjPool(const ObjPool &other)
+    ObjPool(const ObjPool &other) : slabs(nullptr), slab_count(0), table_size(0), capacity(0), last_free(NIL)
     {
-        capacity = other.capacity;
-        last_free = other.last_free;
-        data = new Node[capacity];
-        std::copy(other.data, other.data + other.capacity, data);
+        copy_from(other);
     }
 
     ObjPool(ObjPool &&other)
     {
+        slabs = exchange(other.slabs, nullptr);
+        slab_count = exchange(other.slab_count, 0);
+        table_size = exchange(other.table_size, 0);
         capacity = exchange(other.capacity, 0);
-        last_free = exchange(other.last_free, -1);
-        data = exchange(other.data, nullptr);
+        last_free = exchange(other.last_free, NIL);
     }
 
     ObjPool& operator=(const ObjPool &other)
     {
-        capacity = other.capacity;
-        last_free = other.last_free;
-        if (data)
-            delete[] data;
-        data = new Node[capacity];
-        std::copy(other.data, other.data + other.capacity, data);
+        if (this == &other)
+            return (*this);
+        clear();
+        copy_from(other);
         return (*this);
     }
 
     ObjPool& operator=(ObjPool &&other)
     {
+        clear();
+        slabs = exchange(other.slabs, nullptr);
+        slab_count = exchange(other.slab_count, 0);
+        table_size = exchange(other.table_size, 0);
         capacity = exchange(other.capacity, 0);
-        last_free = exchange(other.last_free, -1);
-        if (data)
-            delete[] data;
-        data = exchange(other.data, nullptr);
+        last_free = exchange(other.last_free, NIL);
         return (*this);
     }
     
 
-    ObjPool(size_t capacity=1) : capacity(capacity) 
+    ObjPool(size_t capacity=0) : slabs(nullptr), slab_count(0), table_size(0), capacity(0), last_free(NIL)
     {
-        data = new Node [capacity];
-        for (size_t i=0; i<capacity - 1; ++i)
-            data[i].next = i + 1;
-        data[capacity - 1].next = -1;
-        
-        last_free = 0;
+        while (this->capacity < capacity)
+            add_slab();
     }
-
     ~ObjPool()
     {
-        delete [] data;
+        clear();
     }
     
-    size_t alloc()
+    template<class... Args>
+    Index alloc(Args&&... args)                 // constructs Data from args in the slot
     {
         refit();
-        size_t result = last_free;
-        last_free = data[last_free].next;
+        Index result = last_free;
+        Node &v = node(result);
+        last_free = v.next;
+        if constexpr (std::is_constructible_v<Data, Args...>)
+            new (&v.val) Data(std::forward<Args>(args)...);
+        else
+            new (&v.val) Data{std::forward<Args>(args)...};
         return result;
     }
     
-    Data *get(size_t id) const
+    Data *get(Index id) const
     {
-        assert(id != -1);
+        assert(id != NIL);
         assert(id < capacity);
-        return &data[id].val;
+        return &node(id).val;
     }
     
-    void free(size_t id) 
+    void free(Index id) 
     {
-        data[id].next = last_free;
+        Node &v = node(id);
+        v.val.~Data();
+        v.next = last_free;
         last_free = id;
     }
     
+    size_t slots() const { return capacity; }  // allocated slots, free ones included
+
+    void reserve(size_t slots)                  // grows now, so that alloc() does not move the slab table later
+    {
+        while (capacity < slots)
+            add_slab();
+    }
+
     void print(std::ostream& out)
     {
-        for (size_t id = last_free; id != -1; id = data[id].next)
+        for (Index id = last_free; id != NIL; id = node(id).next)
         {
             out << "(" << id << ") -> ";
         }
@@ -110,31 +128,204 @@ public:
     
     
 private:
-    struct Node{
-        size_t next;
+    // A slot holds either the free-list link or a live Data, never both
+    union Node{
+        Index next;
         Data val;
-        // ~Node() {};
+
+        Node() : next(NIL) {}
+        ~Node() {}
     };
+
+    // Nodes live in fixed-size slabs that never move: growth adds a slab and at most
+    // reallocates the table of slab pointers, so ids and Data* stay valid.
+    static constexpr size_t SLAB = size_t(1) << SLAB_BITS;
+    static constexpr size_t MASK = SLAB - 1;
     
-    Node *data;
+    Node **slabs;
+    size_t slab_count;
+    size_t table_size;
     size_t capacity;
-    size_t last_free;
+    Index last_free;
+
+    Node& node(size_t id) const { return slabs[id >> SLAB_BITS][id & MASK]; }
+
+    std::vector<bool> free_ids() const
+    {
+        std::vector<bool> result(capacity, false);
+        for (Index id = last_free; id != NIL; id = node(id).next)
+            result[id] = true;
+        return result;
+    }
+
+    void add_slab()
+    {
+        assert(capacity + SLAB - 1 < size_t(NIL));
+        if (slab_count == table_size)
+        {
+            size_t new_size = table_size ? table_size * 2 : 1;
+            Node **ntable = new Node*[new_size];
+            std::copy(slabs, slabs + slab_count, ntable);
+            delete [] slabs;
+            slabs = ntable;
+            table_size = new_size;
+        }
+        Node *slab = new Node[SLAB];
+        for (size_t i = 0; i < SLAB - 1; ++i)
+            slab[i].next = static_cast<Index>(capacity + i + 1);
+        slab[SLAB - 1].next = last_free;
+        slabs[slab_count++] = slab;
+        last_free = static_cast<Index>(capacity);
+        capacity += SLAB;
+    }
+
+    void copy_from(const ObjPool &other)
+    {
+        slabs = new Node*[other.table_size];
+        table_size = other.table_size;
+        slab_count = other.slab_count;
+        capacity = other.capacity;
+        last_free = other.last_free;
+        std::vector<bool> is_free = other.free_ids();
+        for (size_t i = 0; i < slab_count; ++i)
+        {
+            slabs[i] = new Node[SLAB];
+            for (size_t j = 0; j < SLAB; ++j)
+                if (is_free[(i << SLAB_BITS) + j])
+                    slabs[i][j].next = other.slabs[i][j].next;
+                else
+                    new (&slabs[i][j].val) Data(other.slabs[i][j].val);
+        }
+    }
+
+    void clear()
+    {
+        if constexpr (!std::is_trivially_destructible_v<Data>)
+        {
+            std::vector<bool> is_free = free_ids();
+            for (size_t id = 0; id < capacity; ++id)
+                if (!is_free[id])
+                    node(id).val.~Data();
+        }
+        for (size_t i = 0; i < slab_count; ++i)
+            delete [] slabs[i];
+        delete [] slabs;
+        slabs = nullptr;
+        slab_count = table_size = capacity = 0;
+        last_free = NIL;
+    }
     
     void refit()
     {
-        if (last_free != -1)
+        if (last_free != NIL)
             return;
-        Node *nbuf = new Node[capacity * 2];
-        std::copy(data, data + capacity, nbuf);
-        assert(data);
-        delete [] data;
-        data = nbuf;
-        capacity *= 2;
-        for (size_t i = capacity / 2; i < capacity - 1; ++i)
-            data[i].next = i + 1;
-        data[capacity - 1].next = -1;
-        last_free = capacity / 2;
+        add_slab();
+    }
+};
+
+//==================================
+// Priority policies
+//
+// A Treap asks its own policy object for the priority of every new node, so there is
+// no shared generator and each instance can live in its own thread.
+
+struct xorshiftPriority{                            // xorshift64*, independent of the key
+    uint64_t state;
+
+    xorshiftPriority() : xorshiftPriority(next_seed()) {}           // a stream of its own for every instance
+    explicit xorshiftPriority(uint64_t seed) : state(seed ? seed : 179) {}  // the same seed gives the same shapes
+
+    template<typename Key>
+    uint32_t operator()(const Key &)
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return static_cast<uint32_t>((state * 0x2545F4914F6CDD1Dull) >> 32);
     }
+
+private:
+    static uint64_t next_seed()                     // splitmix64 over a process-wide counter
+    {
+        static std::atomic<uint64_t> counter{179};
+        uint64_t z = counter.fetch_add(0x9e3779b97f4a7c15ull, std::memory_order_relaxed);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+};
+
+template<class Hash = void>
+struct hashPriority{                                // a mix of the key hash: the same keys always give the same shape
+    template<typename Key>
+    uint32_t operator()(const Key &x) const
+    {
+        using hasher = std::conditional_t<std::is_void_v<Hash>, std::hash<Key>, Hash>;
+        uint64_t h = static_cast<uint64_t>(hasher()(x));
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+        return static_cast<uint32_t>(h ^ (h >> 31));
+    }
+};
+
+//==================================
+// Policies for keys found in both operands of unite() and intersect(): resolve(own, other)
+// gets the data of this treap and of the other one and returns the data to keep
+
+struct keepOwn{
+    template<typename Data>
+    const Data& operator()(const Data &own, const Data &) const { return own; }
+};
+
+struct takeOther{                                   // what inserting every element of other would do
+    template<typename Data>
+    const Data& operator()(const Data &, const Data &other) const { return other; }
+};
+
+//==================================
+// Aggregate policies
+//
+// A monoid over the elements of a subtree, kept in every node next to its size:
+// lift(key, data) is the value of one element, combine() is associative and gets its
+// arguments in key order, identity() is the value of no elements.
+
+struct noAggregate{                                 // the default, takes no room in the node
+    struct value_type{};
+
+    template<typename Key, typename Data>
+    value_type lift(const Key &, const Data &) const { return {}; }
+    value_type combine(value_type, value_type) const { return {}; }
+    value_type identity() const { return {}; }
+};
+
+template<typename T>
+struct sumAggregate{
+    using value_type = T;
+
+    template<typename Key, typename Data>
+    T lift(const Key &, const Data &val) const { return static_cast<T>(val); }
+    T combine(const T &a, const T &b) const { return a + b; }
+    T identity() const { return T(); }
+};
+
+template<typename T>
+struct minAggregate{
+    using value_type = T;
+
+    template<typename Key, typename Data>
+    T lift(const Key &, const Data &val) const { return static_cast<T>(val); }
+    T combine(const T &a, const T &b) const { return std::min(a, b); }
+    T identity() const { return std::numeric_limits<T>::max(); }
+};
+
+template<typename T>
+struct maxAggregate{
+    using value_type = T;
+
+    template<typename Key, typename Data>
+    T lift(const Key &, const Data &val) const { return static_cast<T>(val); }
+    T combine(const T &a, const T &b) const { return std::max(a, b); }
+    T identity() const { return std::numeric_limits<T>::lowest(); }
 };
 
 //==================================
@@ -152,27 +343,42 @@ private:
 #define TREAP_CHECK(v) {}
 #endif
 
-template<typename Key, typename Data>
+template<typename Key, typename Data, typename Index = uint32_t, class Priority = xorshiftPriority, class Aggregate = noAggregate>
 class Treap 
 {
+public:
+    using aggregate_type = typename Aggregate::value_type;
+
 private:
+    static constexpr bool AGGREGATED = !std::is_same_v<Aggregate, noAggregate>;
+
+    // With an Aggregate the data is read-only outside insert(x, val), the one write
+    // that brings the aggregates above the node up to date
+    using data_ref = std::conditional_t<AGGREGATED, const Data&, Data&>;
+    using data_ptr = std::conditional_t<AGGREGATED, const Data*, Data*>;
+
      struct Node
     {
         Key x;
-        size_t prior;
+        uint32_t prior;
         Data val = Data();
-        size_t parent;
-        size_t left, right;
-        size_t size;
+        Index parent;
+        Index left, right;
+        Index size;
+        [[no_unique_address]] aggregate_type agg;  // of the subtree, set together with size
         
-        Node()                : prior(rnd()), parent(-1), left(-1), right(-1), size(1) {}
-        Node(Key x, Data val) : x(x), prior(rnd()), val(val), parent(-1), left(-1), right(-1), size(1) {}
+        Node()                : prior(0), parent(NIL), left(NIL), right(NIL), size(1) {}
+        Node(Key x, Data val) : x(x), prior(0), val(val), parent(NIL), left(NIL), right(NIL), size(1) {}
         
         ~Node() {};
     };
 
-    size_t root_id;
-    ObjPool<Node> pool;
+    static constexpr Index NIL = Index(-1);
+
+    Index root_id;
+    ObjPool<Node, Index> pool;
+    Priority priority;
+    [[no_unique_address]] Aggregate monoid;
 
 public:
     struct Iterator 
@@ -181,7 +387,7 @@ public:
         using difference_type   = std::ptrdiff_t;
         using value_type        = Node;
         
-        Iterator( size_t id=-1, const Treap* this_=nullptr ) : id(id), this_(this_), pos(0) {}     // WARNING: don't use for non-begin iterator, pos will invalidate
+        Iterator( Index id=NIL, const Treap* this_=nullptr ) : id(id), this_(this_), pos(0) {}     // WARNING: don't use for non-begin iterator, pos will invalidate
         Iterator( const Iterator &other ) = default;
         
         bool operator==( const Iterator other ) const { return id == other.id; }
@@ -193,9 +399,9 @@ public:
         bool operator>=( const Iterator other ) const { return pos >= other.pos; }
 
         void setPos(size_t pos_) { pos = pos_; }
-        void setId (size_t id_ ) { id  = id_;  }
+        void setId (Index id_ ) { id  = id_;  }
 
-        std::pair<Key, Data&> operator*() { Node* v = this_->pool.get(id); \
+        std::pair<Key, data_ref> operator*() { Node* v = this_->pool.get(id); \
                                             return {v->x, v->val}; }
 
         const std::pair<const Key, const Data&> operator*() const { Node* v = this_->pool.get(id); \
@@ -204,17 +410,17 @@ public:
  
         Iterator operator++() 
         {
-            assert(id != -1);
+            assert(id != NIL);
             ++pos;
             Node* v = this_->pool.get(id);
-            if (v->right != -1)
+            if (v->right != NIL)
             {
                 id = v->right;   
-                while ((v = this_->pool.get(id))->left != -1)
+                while ((v = this_->pool.get(id))->left != NIL)
                     id = v->left;
                 return (*this);
             }
-            while ((v = this_->pool.get(id))->parent != -1)
+            while ((v = this_->pool.get(id))->parent != NIL)
             {
                 if (this_->pool.get(v->parent)->left == id)
                 {
@@ -223,24 +429,24 @@ public:
                 }
                 id = v->parent;
             }
-            id = -1;
+            id = NIL;
             return (*this);
         }
 
         Iterator operator++(int) 
         {
-            assert(id != -1);
+            assert(id != NIL);
             ++pos;
             Node* v = this_->pool.get(id);
             Iterator result(*this);
-            if (v->right != -1)
+            if (v->right != NIL)
             {
                 id = v->right;
-                while ((v = this_->pool.get(id))->left != -1)
+                while ((v = this_->pool.get(id))->left != NIL)
                     id = v->left;
                 return result;
             }
-            while ((v = this_->pool.get(id))->parent != -1)
+            while ((v = this_->pool.get(id))->parent != NIL)
             {
                 if (this_->pool.get(v->parent)->left == id)
                 {
@@ -249,23 +455,23 @@ public:
                 }
                 id = v->parent;
             }
-            id = -1;
+            id = NIL;
             return result;
         }
 
         Iterator operator--()
         {
-            assert(id != -1);
+            assert(id != NIL);
             --pos;
             Node* v = this_->pool.get(id);
-            if (v->left != -1)
+            if (v->left != NIL)
             {
                 id = v->left;
-                while ((v = this_->pool.get(id))->right != -1)
+                while ((v = this_->pool.get(id))->right != NIL)
                     id = v->right;
                 return (*this);
             }
-            while ((v = this_->pool.get(id))->parent != -1)
+            while ((v = this_->pool.get(id))->parent != NIL)
             {
                 if (this_->pool.get(v->parent)->right == id)
                 {
@@ -274,24 +480,24 @@ public:
                 }
                 id = v->parent;
             }
-            id = -1;
+            id = NIL;
             return (*this);
         }
 
         Iterator operator--(int)
         {
-            assert(id != -1);
+            assert(id != NIL);
             --pos;
             Node* v = this_->pool.get(id);
             Iterator result(*this);
-            if (v->left != -1)
+            if (v->left != NIL)
             {
                 id = v->left;
-                while ((v = this_->pool.get(id))->right != -1)
+                while ((v = this_->pool.get(id))->right != NIL)
                     id = v->right;
                 return result;
             }
-            while ((v = this_->pool.get(id))->parent != -1)
+            while ((v = this_->pool.get(id))->parent != NIL)
             {
                 if (this_->pool.get(v->parent)->right == id)
                 {
@@ -300,7 +506,7 @@ public:
                 }
                 id = v->parent;
             }
-            id = -1;
+            id = NIL;
             return result;
         }
         
@@ -329,17 +535,17 @@ public:
 
         private:
             size_t pos;
-            size_t id;
+            Index id;
             const Treap* this_;
     };
 
     Iterator kth_elem(size_t k) const {
         Iterator result(0, this);
         result.setPos(k);
-        size_t id = root_id;
-        assert(id != -1);
+        Index id = root_id;
+        assert(id != NIL);
         Node *v;
-        while (id != -1){
+        while (id != NIL){
             v = pool.get(id);
             size_t i = getSize(v->left);
             if (i == k){
@@ -359,15 +565,16 @@ public:
 
 
     Iterator begin() const { return Iterator(min_vert(root_id), this); } 
-    Iterator end()   const { return Iterator(-1, this); }
+    Iterator end()   const { return Iterator(NIL, this); }
     
    
 
     //======================================
     // TREAP interface functions
 
-    Treap() : root_id(-1) {}
-    Treap(const Treap &other) : root_id(other.root_id), pool(other.pool) {}
+    Treap() : root_id(NIL) {}
+    explicit Treap(Priority priority, Aggregate monoid = Aggregate()) : root_id(NIL), priority(priority), monoid(monoid) {}
+    Treap(const Treap &other) : root_id(other.root_id), pool(other.pool), priority(other.priority), monoid(other.monoid) {}
     Treap(Treap &&other);
     ~Treap() = default;
 
@@ -378,19 +585,52 @@ public:
     bool  operator==( const Treap &other ) const;
     bool  operator!=( const Treap &other ) const { return !((*this) == other); }
 
-    Data& operator[](size_t n) { return (*(begin() + n)).second; }
-    const Data& operator[](size_t n) const { return *(begin() + n); }
+    data_ref    operator[](size_t n) { return (*(begin() + n)).second; }
+    const Data& operator[](size_t n) const { return (*(begin() + n)).second; }
 
-    size_t size() const { if (root_id == -1) return 0; return pool.get(root_id)->size; }
+    size_t size() const { if (root_id == NIL) return 0; return pool.get(root_id)->size; }
 
     void   insert( Key x, Data val );
-    Data*  insert( Key x );
+    Data*  insert( Key x ) requires (!AGGREGATED);     // gives out mutable data, so not with an Aggregate
     
-    void   erase ( Key x ) { if (root_id != -1)  root_id = erase(root_id, x); }
-    size_t erase ( size_t id, Key x );
+    void   erase ( Key x ) { if (root_id != NIL)  root_id = erase(root_id, x); if (root_id != NIL) pool.get(root_id)->parent = NIL; }
+    Index erase ( Index id, Key x );
         
-    Data* find( Key x ) const;
+    data_ptr find( Key x ) const;
+
+    aggregate_type aggregate() const { return agg_of(root_id); }
+    aggregate_type aggregate( const Key &lo, const Key &hi ) const;     // over the keys in [lo, hi], O(log n)
+    size_t         count    ( const Key &lo, const Key &hi ) const;     // keys in [lo, hi], from the sizes
+
+    template<class It>
+    void  build_sorted  ( It first, It last );      // replaces the contents with (key, data) pairs sorted by key, O(n)
+    template<class It>
+    void  build_unsorted( It first, It last, size_t threads = 0 );  // sorts a copy first, on all cores for 0 threads; the last of equal keys wins
         
+    // Set algebra by split and join, O(m log(n/m + 1)) for sizes m <= n. The other treap
+    // is only read; given as an rvalue its pool may be taken over instead, whichever way
+    // copies or frees fewer nodes, and it is left empty.
+    //
+    // These and the bulk updates below fork the two halves of every step onto their own
+    // threads while there are more than one to give (0 is all cores) and the halves are
+    // big enough. resolve and keep are then called concurrently.
+    template<class Resolve = takeOther>
+    void  unite    ( const Treap &other, Resolve resolve = Resolve(), size_t threads = 1 );
+    template<class Resolve = takeOther>
+    void  unite    ( Treap &&other, Resolve resolve = Resolve(), size_t threads = 1 );
+    template<class Resolve = takeOther>
+    void  intersect( const Treap &other, Resolve resolve = Resolve(), size_t threads = 1 );
+    template<class Resolve = takeOther>
+    void  intersect( Treap &&other, Resolve resolve = Resolve(), size_t threads = 1 );
+    void  subtract ( const Treap &other, size_t threads = 1 );
+
+    template<class It>
+    void  insert_sorted( It first, It last, size_t threads = 1 );   // (key, data) pairs sorted by key, their data wins
+    template<class It>
+    void  erase_sorted ( It first, It last, size_t threads = 1 );   // sorted keys
+    template<class Pred>
+    void  filter       ( Pred keep, size_t threads = 1 );           // keeps the elements with keep(key, data)
+
     #ifndef NDEBUG
     void print      ( std::ostream &out ) const { print(out, root_id); out << '\n'; }
     void print_graph( std::ostream &out ) const
@@ -398,71 +638,190 @@ public:
         static size_t dumpn = 0;
         out << "digraph tree" << dumpn++ <<  "{\n"
                "    node [shape=record];\n";
-        if (root_id != -1)
+        if (root_id != NIL)
             print_graph(out, root_id);
         out << "};\n";
     }
     
     bool graph_check() const
     {
-        if (root_id != -1 && pool.get(root_id)->parent != -1)
+        if (root_id != NIL && pool.get(root_id)->parent != NIL)
            return false;
         return graph_check(root_id);
     }
 
-    bool graph_check(size_t id) const
+    bool graph_check(Index id) const
     {
-        std::set<size_t> S;
+        std::set<Index> S;
         return graph_check(id, S);
     }
     #endif  
     
 private:
 
-    bool graph_check( size_t id, std::set<size_t> &S ) const;
-    void print_graph( std::ostream &out, size_t id ) const;
-    void print( std::ostream &out, size_t id ) const;
+    bool graph_check( Index id, std::set<Index> &S ) const;
+    void print_graph( std::ostream &out, Index id ) const;
+    void print( std::ostream &out, Index id ) const;
+
+    Index                   merge( Index tl_id, Index tr_id );
+    std::pair<Index, Index> split( Index t_id, Key k );
+    std::tuple<Index, Index, Index> split3( Index t_id, Key k );   // keys < k, the node with key k or NIL, keys > k
+    Index join( Index tl_id, Index id, Index tr_id );                // all keys of tl < key of the single node id < all keys of tr
+
+    // One branch of a set operation or bulk update. A serial run uses the pool directly.
+    // Under threads the pool is reserved up front and never grows meanwhile, so reading
+    // nodes is safe, and each branch takes ids in batches and gives back the ones it
+    // freed, both under one lock.
+    struct Branch
+    {
+        static constexpr size_t BATCH = 256;
+        static constexpr size_t GRAIN = 4096;       // nodes below which a step does not fork
+
+        Treap      &treap;
+        std::mutex *lock;                           // nullptr for a serial run
+        size_t      threads;                        // this branch may still fork into that many
+        std::vector<Index> spare, garbage;
+
+        Branch( Treap &treap, std::mutex *lock, size_t threads ) : treap(treap), lock(lock), threads(threads) {}
+        Branch( const Branch &other ) = delete;
+        ~Branch() { flush(); }
+
+        Index alloc( const Key &x, const Data &val, uint32_t prior )
+        {
+            Index id;
+            if (!lock)
+                id = treap.pool.alloc(x, val);
+            else
+            {
+                if (spare.empty())
+                {
+                    std::lock_guard<std::mutex> guard(*lock);
+                    for (size_t i = 0; i < BATCH; ++i)
+                        spare.push_back(treap.pool.alloc());
+                }
+                id = spare.back();
+                spare.pop_back();
+                *treap.pool.get(id) = Node(x, val);
+            }
+            Node *v = treap.pool.get(id);
+            v->prior = prior;
+            treap.pull(v);
+            return id;
+        }
+
+        void free( Index id )
+        {
+            if (!lock)
+                treap.pool.free(id);
+            else
+                garbage.push_back(id);
+        }
+
+        void flush()
+        {
+            if (!lock || (spare.empty() && garbage.empty()))
+                return;
+            std::lock_guard<std::mutex> guard(*lock);
+            for (Index id : spare)
+                treap.pool.free(id);
+            for (Index id : garbage)
+                treap.pool.free(id);
+            spare.clear();
+            garbage.clear();
+        }
+
+        // Runs both jobs, the left one on a new thread that gets a share of the threads
+        // in proportion to its work
+        template<class Left, class Right>
+        std::pair<Index, Index> fork( size_t work_l, size_t work_r, Left left, Right right )
+        {
+            if (threads < 2 || work_l + work_r < GRAIN)
+            {
+                Index l_id = left(*this);
+                return {l_id, right(*this)};
+            }
+            size_t threads_l = std::clamp<size_t>(threads * work_l / (work_l + work_r), 1, threads - 1);
+            Index l_id = NIL, r_id = NIL;
+            {
+                Branch child(treap, lock, threads_l);
+                threads -= threads_l;
+                std::thread worker([&](){ l_id = left(child); });
+                r_id = right(*this);
+                worker.join();
+                threads += threads_l;
+            }
+            return {l_id, r_id};
+        }
+    };
 
-    size_t                    merge( size_t tl_id, size_t tr_id );
-    std::pair<size_t, size_t> split( size_t t_id, Key k );
+    template<class Job>
+    void  in_branches( size_t threads, size_t new_nodes, Job job );    // job(Branch&) on the root branch
+
+    template<class Resolve>
+    Index unite    ( Index t_id, const Treap &other, Index o_id, Resolve &resolve, Branch &branch );
+    template<class Resolve>
+    Index intersect( Index t_id, const Treap &other, Index o_id, Resolve &resolve, Branch &branch );
+    Index subtract ( Index t_id, const Treap &other, Index o_id, Branch &branch );
+    template<class Pred>
+    Index filter   ( Index t_id, Pred &keep, Branch &branch );
+    Index copy_subtree( const Treap &other, Index o_id, Branch &branch );
+    void  free_subtree( Index t_id, Branch &branch );
+    void  take_pool   ( Treap &other );             // swaps trees and pools, the priority policy stays
    
-    void update( size_t id );
+    void update( Index id );
+    void resize_up( Index id );
+
+    std::pair<Index, bool> place( Key x, const Data &val );    // id of the node with key x, true if it was created
+
+    template<class It>
+    static void parallel_sort( It first, It last, size_t threads );
     void insert( Node &node);                       //TODO write it to emplement faster 0 nodes removal
 
-    size_t getSize( size_t v_id ) const { if (v_id == -1) return 0; return pool.get(v_id)->size; }
+    size_t getSize( Index v_id ) const { if (v_id == NIL) return 0; return pool.get(v_id)->size; }
+    aggregate_type agg_of( Index v_id ) const { if (v_id == NIL) return monoid.identity(); return pool.get(v_id)->agg; }
+
+    void pull( Node *v ) const;                     // size and aggregate of v from its children
 
-    size_t min_vert( size_t v_id ) const;
-    size_t max_vert( size_t v_id ) const;
+    template<class T, class Lift, class Sub, class Combine>
+    T range_fold( const Key &lo, const Key &hi, T none, Lift lift, Sub sub, Combine combine ) const;
+
+    Index min_vert( Index v_id ) const;
+    Index max_vert( Index v_id ) const;
 };
 
 
-template<typename Key, typename Data>
-Treap<Key, Data>::Treap(Treap &&other)
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+Treap<Key, Data, Index, Priority, Aggregate>::Treap(Treap &&other)
+    : priority(other.priority), monoid(other.monoid)
 {
-    root_id = exchange(other.root_id, -1);
+    root_id = exchange(other.root_id, NIL);
     pool = std::move(other.pool);
 }
 
 
-template<typename Key, typename Data>
-Treap<Key, Data>& Treap<Key, Data>::operator=(const Treap<Key, Data> &other)
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+Treap<Key, Data, Index, Priority, Aggregate>& Treap<Key, Data, Index, Priority, Aggregate>::operator=(const Treap<Key, Data, Index, Priority, Aggregate> &other)
 {
     root_id = other.root_id;
     pool = other.pool;
+    priority = other.priority;
+    monoid = other.monoid;
     return (*this);
 }
 
-template<typename Key, typename Data>
-Treap<Key, Data>& Treap<Key, Data>::operator=(Treap<Key, Data> &&other)
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+Treap<Key, Data, Index, Priority, Aggregate>& Treap<Key, Data, Index, Priority, Aggregate>::operator=(Treap<Key, Data, Index, Priority, Aggregate> &&other)
 {
-    root_id = exchange(other.root_id, -1);
+    root_id = exchange(other.root_id, NIL);
     pool = std::move(other.pool);
+    priority = other.priority;
+    monoid = other.monoid;
     return (*this);
 }
 
 
-template<typename Key, typename Data>
-bool Treap<Key, Data>::operator==(const Treap<Key, Data> &other) const {
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+bool Treap<Key, Data, Index, Priority, Aggregate>::operator==(const Treap<Key, Data, Index, Priority, Aggregate> &other) const {
     if (root_id != other.root_id)
         return false;
 
@@ -479,123 +838,496 @@ bool Treap<Key, Data>::operator==(const Treap<Key, Data> &other) const {
 }
 
 
-template<typename Key, typename Data>
-void Treap<Key, Data>::insert(Key x, Data val)
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+void Treap<Key, Data, Index, Priority, Aggregate>::insert(Key x, Data val)
 {
-    Data* q = find(x);
-    if (q)
+    auto [id, created] = place(x, val);
+    if (!created)
     {
-        *q = val;
-        return;
+        pool.get(id)->val = val;
+        if constexpr (AGGREGATED)
+            resize_up(id);
     }
-        
-    auto [tl_id, tr_id] = split(root_id, x);
-    size_t tm_id = pool.alloc();
-    assert(tm_id != -1);
-    Node *v = pool.get(tm_id);
-    v->val = val;
-    v->x = x;
-    root_id = merge(merge(tl_id, tm_id), tr_id);
     TREAP_CHECK(root_id);
 }
 
-template<typename Key, typename Data>
-Data* Treap<Key, Data>::insert(Key x)
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+Data* Treap<Key, Data, Index, Priority, Aggregate>::insert(Key x) requires (!AGGREGATED)
 {
-    Data* q = find(x);
-    if (q)
-        return q;
-        
-    auto [tl_id, tr_id] = split(root_id, x);
-    size_t tm_id = pool.alloc();
-    assert(tm_id != -1);
-    Node *v = pool.get(tm_id);
-    v->x = x;
-    root_id = merge(merge(tl_id, tm_id), tr_id);
+    Index id = place(x, Data()).first;
     TREAP_CHECK(root_id);
-    return &(v->val);
+    return &(pool.get(id)->val);
+}
+
+// One descent: above the point where the new priority wins only the key is compared,
+// from there on the subtree is split by x into the children of the new node. A node
+// with key x met during the split keeps its data and its own priority, and join()
+// puts the pieces back in heap order, so updates do not pull keys toward the root.
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+std::pair<Index, bool> Treap<Key, Data, Index, Priority, Aggregate>::place(Key x, const Data &val)
+{
+    uint32_t prior = priority(x);
+    Index parent_id = NIL, cur_id = root_id;
+    while (cur_id != NIL)
+    {
+        Node *v = pool.get(cur_id);
+        if (v->x == x)
+            return {cur_id, false};
+        if (prior <= v->prior)
+            break;
+        parent_id = cur_id;
+        cur_id = x < v->x ? v->left : v->right;
+    }
+
+    auto [tl_id, found, tr_id] = split3(cur_id, x);
+    Index id = found, sub_id;
+    if (found != NIL)
+        sub_id = join(tl_id, found, tr_id);
+    else
+    {
+        id = sub_id = pool.alloc(x, val);
+        Node *v = pool.get(id);
+        v->prior = prior;
+        v->left = tl_id;
+        v->right = tr_id;
+        update(id);
+    }
+    pool.get(sub_id)->parent = parent_id;
+
+    if (parent_id == NIL)
+        root_id = sub_id;
+    else if (x < pool.get(parent_id)->x)
+        pool.get(parent_id)->left = sub_id;
+    else
+        pool.get(parent_id)->right = sub_id;
+    if constexpr (AGGREGATED)
+        resize_up(parent_id);
+    else if (found == NIL)
+        for (Index p = parent_id; p != NIL; p = pool.get(p)->parent)
+            ++pool.get(p)->size;
+    return {id, found == NIL};
 }
 
 
-template<typename Key, typename Data>
-size_t Treap<Key, Data>::erase(size_t id, Key x) //TODO find bug
+// Cartesian tree on a stack of the right spine: a new node takes the popped tail of the
+// spine as its left child, and a node gets its size when it is popped, since both of
+// its subtrees are final by then. The nodes come from one pool reservation in key order.
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class It>
+void Treap<Key, Data, Index, Priority, Aggregate>::build_sorted(It first, It last)
 {
-    if (id == -1)
-        return -1;
-    Node *v = pool.get(id);
-    if (v->x == x)
-    {
-        size_t tl_id = v->left;
-        size_t tr_id = v->right;
-      
-        v->parent = -1;
-        if (tr_id != -1)
-            pool.get(tr_id)->parent = -1;
-        if (tl_id != -1)
-            pool.get(tl_id)->parent = -1;
-
-        pool.free(id);
-        return merge(tl_id, tr_id);
+    size_t n = static_cast<size_t>(std::distance(first, last));
+    pool = ObjPool<Node, Index>(n);
+    root_id = NIL;
+    std::vector<Index> spine;
+
+    auto pop = [&]()
+    {
+        Index id = spine.back();
+        spine.pop_back();
+        pull(pool.get(id));
+        return id;
+    };
+
+    for (; first != last; ++first)
+    {
+        const auto &[x, val] = *first;
+        if (!spine.empty())
+        {
+            Node *top = pool.get(spine.back());
+            assert(!(x < top->x));
+            if (top->x == x)
+            {
+                top->val = val;
+                continue;
+            }
+        }
+        Index id = pool.alloc(x, val);
+        Node *v = pool.get(id);
+        v->prior = priority(x);
+
+        Index below = NIL;
+        while (!spine.empty() && pool.get(spine.back())->prior > v->prior)
+            below = pop();
+        v->left = below;
+        if (below != NIL)
+            pool.get(below)->parent = id;
+        if (!spine.empty())
+        {
+            v->parent = spine.back();
+            pool.get(spine.back())->right = id;
+        }
+        spine.push_back(id);
+    }
+    while (!spine.empty())
+        root_id = pop();
+    TREAP_CHECK(root_id);
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class It>
+void Treap<Key, Data, Index, Priority, Aggregate>::build_unsorted(It first, It last, size_t threads)
+{
+    std::vector<std::pair<Key, Data>> items(first, last);
+    parallel_sort(items.begin(), items.end(), threads ? threads : std::max(1u, std::thread::hardware_concurrency()));
+    build_sorted(items.begin(), items.end());
+}
+
+// Stable sort by key: chunks are sorted on their own threads, then neighbours are
+// merged pairwise, all pairs of a round in parallel
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class It>
+void Treap<Key, Data, Index, Priority, Aggregate>::parallel_sort(It first, It last, size_t threads)
+{
+    auto less = [](const auto &a, const auto &b){ return a.first < b.first; };
+    size_t n = static_cast<size_t>(last - first);
+    size_t chunks = std::min(threads, n / 4096 + 1);
+    std::vector<It> bounds;
+    for (size_t i = 0; i <= chunks; ++i)
+        bounds.push_back(first + n * i / chunks);
+
+    auto in_parallel = [](size_t count, auto job)
+    {
+        if (count == 1)                             // nothing to run alongside, no thread to start
+        {
+            job(0);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (size_t k = 0; k < count; ++k)
+            workers.emplace_back(job, k);
+        for (auto &worker : workers)
+            worker.join();
+    };
+    in_parallel(chunks, [&](size_t i){ std::stable_sort(bounds[i], bounds[i + 1], less); });
+    for (size_t step = 1; step < chunks; step *= 2)
+        in_parallel((chunks + step - 1) / (2 * step), [&, step](size_t k)
+        {
+            size_t i = 2 * step * k;
+            std::inplace_merge(bounds[i], bounds[i + step], bounds[std::min(i + 2 * step, chunks)], less);
+        });
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class Resolve>
+void Treap<Key, Data, Index, Priority, Aggregate>::unite(const Treap &other, Resolve resolve, size_t threads)
+{
+    assert(&other != this);
+    in_branches(threads, other.size(), [&](Branch &branch){ root_id = unite(root_id, other, other.root_id, resolve, branch); });
+    TREAP_CHECK(root_id);
+}
+
+// The larger tree keeps its nodes, only the ones missing from it get copied
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class Resolve>
+void Treap<Key, Data, Index, Priority, Aggregate>::unite(Treap &&other, Resolve resolve, size_t threads)
+{
+    if (other.size() > size())
+    {
+        take_pool(other);
+        auto flipped = [&resolve](const Data &own, const Data &theirs) -> decltype(auto) { return resolve(theirs, own); };
+        unite(std::as_const(other), flipped, threads);
+    }
+    else
+        unite(std::as_const(other), resolve, threads);
+    other.root_id = NIL;
+    other.pool = ObjPool<Node, Index>();
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class Resolve>
+void Treap<Key, Data, Index, Priority, Aggregate>::intersect(const Treap &other, Resolve resolve, size_t threads)
+{
+    assert(&other != this);
+    in_branches(threads, 0, [&](Branch &branch){ root_id = intersect(root_id, other, other.root_id, resolve, branch); });
+    TREAP_CHECK(root_id);
+}
+
+// The smaller tree keeps its nodes, so at most its size gets freed one by one
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class Resolve>
+void Treap<Key, Data, Index, Priority, Aggregate>::intersect(Treap &&other, Resolve resolve, size_t threads)
+{
+    if (other.size() < size())
+    {
+        take_pool(other);
+        auto flipped = [&resolve](const Data &own, const Data &theirs) -> decltype(auto) { return resolve(theirs, own); };
+        intersect(std::as_const(other), flipped, threads);
+    }
+    else
+        intersect(std::as_const(other), resolve, threads);
+    other.root_id = NIL;
+    other.pool = ObjPool<Node, Index>();
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+void Treap<Key, Data, Index, Priority, Aggregate>::subtract(const Treap &other, size_t threads)
+{
+    assert(&other != this);
+    in_branches(threads, 0, [&](Branch &branch){ root_id = subtract(root_id, other, other.root_id, branch); });
+    TREAP_CHECK(root_id);
+}
+
+// The batch becomes a treap in O(m) and is united in; its priorities come from our
+// policy, which then continues after them
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class It>
+void Treap<Key, Data, Index, Priority, Aggregate>::insert_sorted(It first, It last, size_t threads)
+{
+    Treap batch(priority, monoid);
+    batch.build_sorted(first, last);
+    priority = batch.priority;
+    unite(std::move(batch), takeOther(), threads);
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class It>
+void Treap<Key, Data, Index, Priority, Aggregate>::erase_sorted(It first, It last, size_t threads)
+{
+    std::vector<std::pair<Key, Data>> items;
+    for (; first != last; ++first)
+        items.emplace_back(*first, Data());
+    Treap batch(priority, monoid);
+    batch.build_sorted(items.begin(), items.end());
+    subtract(batch, threads);
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class Pred>
+void Treap<Key, Data, Index, Priority, Aggregate>::filter(Pred keep, size_t threads)
+{
+    in_branches(threads, 0, [&](Branch &branch){ root_id = filter(root_id, keep, branch); });
+    if (root_id != NIL)
+        pool.get(root_id)->parent = NIL;
+    TREAP_CHECK(root_id);
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+void Treap<Key, Data, Index, Priority, Aggregate>::take_pool(Treap &other)
+{
+    std::swap(root_id, other.root_id);
+    std::swap(pool, other.pool);
+}
+
+// A threaded run reserves every node it may allocate plus the batches the branches
+// can hold at once, so the pool does not grow under the readers
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class Job>
+void Treap<Key, Data, Index, Priority, Aggregate>::in_branches(size_t threads, size_t new_nodes, Job job)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    if (threads == 1)
+    {
+        Branch branch(*this, nullptr, 1);
+        job(branch);
+        return;
+    }
+    pool.reserve(size() + new_nodes + threads * Branch::BATCH);
+    std::mutex lock;
+    [[maybe_unused]] size_t slots = pool.slots();
+    {
+        Branch branch(*this, &lock, threads);
+        job(branch);
     }
+    assert(pool.slots() == slots);
+}
 
-    if (v->x < x)
-        v->right = erase(v->right, x);
+// The recursions below walk the other tree and split this one by the key of its root;
+// the other tree is never changed, so it may live in a different pool. The halves
+// are joined back by merge, which restores the heap order whatever the priorities,
+// and are independent of each other, so a branch can take one of them to a thread.
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class Resolve>
+Index Treap<Key, Data, Index, Priority, Aggregate>::unite(Index t_id, const Treap &other, Index o_id, Resolve &resolve, Branch &branch)
+{
+    if (o_id == NIL)
+        return t_id;
+    if (t_id == NIL)
+        return copy_subtree(other, o_id, branch);
+    const Node *o = other.pool.get(o_id);
+    Index tl_id, id, tr_id;
+    std::tie(tl_id, id, tr_id) = split3(t_id, o->x);
+    if (id == NIL)
+        id = branch.alloc(o->x, o->val, o->prior);
     else
-        v->left = erase(v->left, x);
+    {
+        pool.get(id)->val = resolve(pool.get(id)->val, o->val);
+        pull(pool.get(id));
+    }
+    std::tie(tl_id, tr_id) = branch.fork(getSize(tl_id) + other.getSize(o->left), getSize(tr_id) + other.getSize(o->right),
+        [&](Branch &b){ return unite(tl_id, other, o->left, resolve, b); },
+        [&](Branch &b){ return unite(tr_id, other, o->right, resolve, b); });
+    return join(tl_id, id, tr_id);
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class Resolve>
+Index Treap<Key, Data, Index, Priority, Aggregate>::intersect(Index t_id, const Treap &other, Index o_id, Resolve &resolve, Branch &branch)
+{
+    if (t_id == NIL || o_id == NIL)
+    {
+        free_subtree(t_id, branch);
+        return NIL;
+    }
+    const Node *o = other.pool.get(o_id);
+    Index tl_id, id, tr_id;
+    std::tie(tl_id, id, tr_id) = split3(t_id, o->x);
+    std::tie(tl_id, tr_id) = branch.fork(getSize(tl_id) + other.getSize(o->left), getSize(tr_id) + other.getSize(o->right),
+        [&](Branch &b){ return intersect(tl_id, other, o->left, resolve, b); },
+        [&](Branch &b){ return intersect(tr_id, other, o->right, resolve, b); });
+    if (id == NIL)
+        return merge(tl_id, tr_id);
+    pool.get(id)->val = resolve(pool.get(id)->val, o->val);
+    pull(pool.get(id));
+    return join(tl_id, id, tr_id);
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+Index Treap<Key, Data, Index, Priority, Aggregate>::subtract(Index t_id, const Treap &other, Index o_id, Branch &branch)
+{
+    if (t_id == NIL || o_id == NIL)
+        return t_id;
+    const Node *o = other.pool.get(o_id);
+    Index tl_id, id, tr_id;
+    std::tie(tl_id, id, tr_id) = split3(t_id, o->x);
+    if (id != NIL)
+        branch.free(id);
+    std::tie(tl_id, tr_id) = branch.fork(getSize(tl_id) + other.getSize(o->left), getSize(tr_id) + other.getSize(o->right),
+        [&](Branch &b){ return subtract(tl_id, other, o->left, b); },
+        [&](Branch &b){ return subtract(tr_id, other, o->right, b); });
+    return merge(tl_id, tr_id);
+}
 
+// A kept node still has the smallest priority of its subtree, so join hangs the
+// filtered children under it in O(1); a dropped one leaves them to merge
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class Pred>
+Index Treap<Key, Data, Index, Priority, Aggregate>::filter(Index t_id, Pred &keep, Branch &branch)
+{
+    if (t_id == NIL)
+        return NIL;
+    Node *v = pool.get(t_id);
+    Index tl_id, tr_id;
+    std::tie(tl_id, tr_id) = branch.fork(getSize(v->left), getSize(v->right),
+        [&](Branch &b){ return filter(v->left, keep, b); },
+        [&](Branch &b){ return filter(v->right, keep, b); });
+    if (tl_id != NIL)
+        pool.get(tl_id)->parent = NIL;
+    if (tr_id != NIL)
+        pool.get(tr_id)->parent = NIL;
+    if (!keep(std::as_const(v->x), std::as_const(v->val)))
+    {
+        branch.free(t_id);
+        return merge(tl_id, tr_id);
+    }
+    v->parent = NIL;
+    return join(tl_id, t_id, tr_id);
+}
+
+// Same shape and priorities as the source subtree
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+Index Treap<Key, Data, Index, Priority, Aggregate>::copy_subtree(const Treap &other, Index o_id, Branch &branch)
+{
+    if (o_id == NIL)
+        return NIL;
+    const Node *o = other.pool.get(o_id);
+    Index id = branch.alloc(o->x, o->val, o->prior);
+    Node *v = pool.get(id);
+    std::tie(v->left, v->right) = branch.fork(other.getSize(o->left), other.getSize(o->right),
+        [&](Branch &b){ return copy_subtree(other, o->left, b); },
+        [&](Branch &b){ return copy_subtree(other, o->right, b); });
     update(id);
+    return id;
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+void Treap<Key, Data, Index, Priority, Aggregate>::free_subtree(Index t_id, Branch &branch)
+{
+    if (t_id == NIL)
+        return;
+    Node *v = pool.get(t_id);
+    free_subtree(v->left, branch);
+    free_subtree(v->right, branch);
+    branch.free(t_id);
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+Index Treap<Key, Data, Index, Priority, Aggregate>::erase(Index id, Key x)
+{
+    Index cur_id = id;
+    Node *v = nullptr;
+    while (cur_id != NIL && (v = pool.get(cur_id))->x != x)
+        cur_id = v->x < x ? v->right : v->left;
+    if (cur_id == NIL)
+        return id;
+
+    Index parent_id = v->parent;
+    Index sub_id = merge(v->left, v->right);
+    pool.free(cur_id);
+    if (cur_id == id)
+        return sub_id;
+
+    Node *p = pool.get(parent_id);
+    if (p->left == cur_id)
+        p->left = sub_id;
+    else
+        p->right = sub_id;
+    if (sub_id != NIL)
+        pool.get(sub_id)->parent = parent_id;
+    resize_up(parent_id);
     TREAP_CHECK(root_id);
     return id;
 }
 
-template<typename Key, typename Data>
-Data* Treap<Key, Data>::find(Key x) const
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+auto Treap<Key, Data, Index, Priority, Aggregate>::find(Key x) const -> data_ptr
 {
-    size_t cur_id = root_id;
+    Index cur_id = root_id;
     Node *v;
-    while (cur_id != -1 && ((v = pool.get(cur_id))->x != x))
+    while (cur_id != NIL && ((v = pool.get(cur_id))->x != x))
     {
         if (v->x > x)
             cur_id = v->left;
         else
             cur_id = v->right;
     }
-    if (cur_id != -1)
+    if (cur_id != NIL)
         return &v->val;
     return nullptr;
 }
 
-template<typename Key, typename Data>
-bool Treap<Key, Data>::graph_check(size_t id, std::set<size_t> &S) const
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+bool Treap<Key, Data, Index, Priority, Aggregate>::graph_check(Index id, std::set<Index> &S) const
 {
-    if (id == -1)
+    if (id == NIL)
         return true;            
     if (S.find(id) != S.end())
         return false;
     S.insert(id);
     Node *v = pool.get(id);
-    if (v->right != -1)
+    if (v->right != NIL)
         if (!graph_check(v->right, S) || pool.get(v->right)->parent != id)
             return false;
-    if (v->left != -1)
+    if (v->left != NIL)
         if (!graph_check(v->left, S) || pool.get(v->left)->parent != id)
             return false;
     return true;
 }
 
-template<typename Key, typename Data>
-void Treap<Key, Data>::print_graph(std::ostream &out, size_t id) const
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+void Treap<Key, Data, Index, Priority, Aggregate>::print_graph(std::ostream &out, Index id) const
 {
-    assert(id != -1);
+    assert(id != NIL);
     Node *v = pool.get(id);
     out << "struct" << id << " [label=\"" << id << " | { key = " << v->x << " | data = " << v->val
     << " }\"];\n";
-    if (v->left != -1)
+    if (v->left != NIL)
     {
         out << "struct" << id << " -> " << "struct" << v->left << ";\n";
         print_graph(out, v->left);
     }
-    if (v->right != -1)
+    if (v->right != NIL)
     {
         out << "struct" << id << " -> " << "struct" << v->right << ";\n";
         print_graph(out, v->right);
@@ -603,103 +1335,285 @@ void Treap<Key, Data>::print_graph(std::ostream &out, size_t id) const
 }
 
 
-template<typename Key, typename Data>
-size_t Treap<Key, Data>::merge(size_t tl_id, size_t tr_id)
+// Both trees are walked top-down, the winner of every step is hung under the last
+// hung node; parents are set on the way and sizes fixed on the way back up
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+Index Treap<Key, Data, Index, Priority, Aggregate>::merge(Index tl_id, Index tr_id)
 {
     TREAP_CHECK(tl_id);
     TREAP_CHECK(tr_id);
-    if (tl_id == -1)
-        return tr_id;
-    if (tr_id == -1)
-        return tl_id;
-    Node *tl = pool.get(tl_id);
-    Node *tr = pool.get(tr_id);
-    if (tl->prior < tr->prior)
-    {
-        tl->right = merge(tl->right, tr_id);
-        update(tl_id);
-        TREAP_CHECK(tl_id);
-        return tl_id;
+    Index root_id = NIL, last_id = NIL;
+    bool  last_left = false;                        // the last hung node came from tl, so the next one goes to its right
+    auto hang = [&](Index id)
+    {
+        if (last_id == NIL)
+            root_id = id;
+        else if (last_left)
+            pool.get(last_id)->right = id;
+        else
+            pool.get(last_id)->left = id;
+        if (id != NIL)
+            pool.get(id)->parent = last_id;
+    };
+
+    while (tl_id != NIL && tr_id != NIL)
+    {
+        Node *tl = pool.get(tl_id);
+        Node *tr = pool.get(tr_id);
+        if (tl->prior < tr->prior)
+        {
+            hang(tl_id);
+            last_id = tl_id;
+            last_left = true;
+            tl_id = tl->right;
+        }
+        else
+        {
+            hang(tr_id);
+            last_id = tr_id;
+            last_left = false;
+            tr_id = tr->left;
+        }
     }
-    else
+    hang(tl_id != NIL ? tl_id : tr_id);
+    resize_up(last_id);
+    TREAP_CHECK(root_id);
+    return root_id;
+}
+
+// Keys <= k go left. Every node on the search path joins the spine of its side,
+// the subtree it keeps stays whole
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+std::pair<Index, Index> Treap<Key, Data, Index, Priority, Aggregate>::split(Index t_id, Key k)
+{
+    Index tl_id = NIL, tr_id = NIL;                 // roots of the halves
+    Index l_last = NIL, r_last = NIL;               // their lowest spine nodes, the open ends
+    while (t_id != NIL)
+    {
+        Node *t = pool.get(t_id);
+        if (t->x <= k)
+        {
+            if (l_last == NIL)
+                tl_id = t_id;
+            else
+                pool.get(l_last)->right = t_id;
+            t->parent = l_last;
+            l_last = t_id;
+            t_id = t->right;
+        }
+        else
+        {
+            if (r_last == NIL)
+                tr_id = t_id;
+            else
+                pool.get(r_last)->left = t_id;
+            t->parent = r_last;
+            r_last = t_id;
+            t_id = t->left;
+        }
+    }
+    if (l_last != NIL)
+        pool.get(l_last)->right = NIL;
+    if (r_last != NIL)
+        pool.get(r_last)->left = NIL;
+    resize_up(l_last);
+    resize_up(r_last);
+    TREAP_CHECK(tl_id);
+    TREAP_CHECK(tr_id);
+    return {tl_id, tr_id};
+}
+
+// The middle node goes on top when its priority allows, else it is merged in like a tree
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+Index Treap<Key, Data, Index, Priority, Aggregate>::join(Index tl_id, Index id, Index tr_id)
+{
+    Node *v = pool.get(id);
+    if ((tl_id == NIL || v->prior <= pool.get(tl_id)->prior) && (tr_id == NIL || v->prior <= pool.get(tr_id)->prior))
     {
-        tr->left = merge(tl_id, tr->left);
-        update(tr_id);
-        TREAP_CHECK(tr_id);
-        return tr_id;
+        v->left = tl_id;
+        v->right = tr_id;
+        update(id);
+        return id;
     }
+    return merge(merge(tl_id, id), tr_id);
 }
 
-template<typename Key, typename Data>
-std::pair<size_t, size_t> Treap<Key, Data>::split(size_t t_id, Key k)
+// split() that also takes out the node with key k: keys < k go left, keys > k right,
+// the node itself comes back detached, or NIL if there is none
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+std::tuple<Index, Index, Index> Treap<Key, Data, Index, Priority, Aggregate>::split3(Index t_id, Key k)
 {
-    if (t_id == -1)
-        return {-1, -1};
-    Node *t = pool.get(t_id);
-               
-    if (t->x <= k)
+    Index tl_id = NIL, tr_id = NIL, l_last = NIL, r_last = NIL, found = NIL;
+    Index l_rest = NIL, r_rest = NIL;               // what hangs at the open ends once the walk stops
+    while (t_id != NIL)
     {
-        auto [tl_id, tr_id] = split(t->right, k);
-        t->right = tl_id;
-        update(t_id);
-        if (tr_id != -1)
-            pool.get(tr_id)->parent = -1;
-        t->parent = -1;
-        TREAP_CHECK(tr_id);
-        TREAP_CHECK(t_id);
-        return {t_id, tr_id};
+        Node *t = pool.get(t_id);
+        if (t->x == k)
+        {
+            found = t_id;
+            l_rest = t->left;
+            r_rest = t->right;
+            break;
+        }
+        if (t->x < k)
+        {
+            if (l_last == NIL)
+                tl_id = t_id;
+            else
+                pool.get(l_last)->right = t_id;
+            t->parent = l_last;
+            l_last = t_id;
+            t_id = t->right;
+        }
+        else
+        {
+            if (r_last == NIL)
+                tr_id = t_id;
+            else
+                pool.get(r_last)->left = t_id;
+            t->parent = r_last;
+            r_last = t_id;
+            t_id = t->left;
+        }
     }
+    if (l_last == NIL)
+        tl_id = l_rest;
+    else
+        pool.get(l_last)->right = l_rest;
+    if (l_rest != NIL)
+        pool.get(l_rest)->parent = l_last;
+    if (r_last == NIL)
+        tr_id = r_rest;
     else
+        pool.get(r_last)->left = r_rest;
+    if (r_rest != NIL)
+        pool.get(r_rest)->parent = r_last;
+    resize_up(l_last);
+    resize_up(r_last);
+    if (found != NIL)
     {
-        auto [tl_id, tr_id] = split(t->left, k);
-        t->left = tr_id;
-        update(t_id);
-        if (tl_id != -1)
-            pool.get(tl_id)->parent = -1;
-        t->parent = -1;
-        TREAP_CHECK(tl_id);
-        TREAP_CHECK(t_id);
-        return {tl_id, t_id};
+        Node *v = pool.get(found);
+        v->parent = v->left = v->right = NIL;
+        pull(v);
+    }
+    return {tl_id, found, tr_id};
+}
+
+// Recomputes sizes from id up to its root; only nodes on that path have changed children
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+void Treap<Key, Data, Index, Priority, Aggregate>::resize_up(Index id)
+{
+    while (id != NIL)
+    {
+        Node *v = pool.get(id);
+        pull(v);
+        id = v->parent;
     }
 }
  
-template<typename Key, typename Data>
-void Treap<Key, Data>::update(size_t id)
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+void Treap<Key, Data, Index, Priority, Aggregate>::update(Index id)
 {
-    assert(id != -1);
+    assert(id != NIL);
 
     Node* v = pool.get(id);
-    v->size = 1;
-    if (v->left != -1)
+    if (v->left != NIL)
+        pool.get(v->left)->parent = id;
+    if (v->right != NIL)
+        pool.get(v->right)->parent = id;
+    pull(v);
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+void Treap<Key, Data, Index, Priority, Aggregate>::pull(Node *v) const
+{
+    v->size = static_cast<Index>(1 + getSize(v->left) + getSize(v->right));
+    if constexpr (AGGREGATED)
+        v->agg = monoid.combine(monoid.combine(agg_of(v->left), monoid.lift(v->x, v->val)), agg_of(v->right));
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+typename Treap<Key, Data, Index, Priority, Aggregate>::aggregate_type
+Treap<Key, Data, Index, Priority, Aggregate>::aggregate(const Key &lo, const Key &hi) const
+{
+    static_assert(AGGREGATED, "aggregate() needs an Aggregate policy");
+    return range_fold(lo, hi, monoid.identity(),
+                      [this](const Node *v){ return monoid.lift(v->x, v->val); },
+                      [this](Index id){ return agg_of(id); },
+                      [this](const aggregate_type &a, const aggregate_type &b){ return monoid.combine(a, b); });
+}
+
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+size_t Treap<Key, Data, Index, Priority, Aggregate>::count(const Key &lo, const Key &hi) const
+{
+    return range_fold(lo, hi, size_t(0), [](const Node *){ return size_t(1); },
+                      [this](Index id){ return getSize(id); }, std::plus<size_t>());
+}
+
+// No splits: below the highest node inside [lo, hi] one walk goes down to lo and takes
+// every subtree to the right of its path, another one does the same towards hi, so
+// O(log n) whole subtrees are combined, in key order
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+template<class T, class Lift, class Sub, class Combine>
+T Treap<Key, Data, Index, Priority, Aggregate>::range_fold(const Key &lo, const Key &hi, T none, Lift lift, Sub sub, Combine combine) const
+{
+    Index id = root_id;
+    Node *v = nullptr;
+    while (id != NIL)
+    {
+        v = pool.get(id);
+        if (v->x < lo)
+            id = v->right;
+        else if (hi < v->x)
+            id = v->left;
+        else
+            break;
+    }
+    if (id == NIL)
+        return none;
+
+    T left = none, right = none;
+    for (Index l_id = v->left; l_id != NIL; )
     {
-        Node* tl = pool.get(v->left);
-        v->size += tl->size;
-        tl->parent = id;
+        Node *l = pool.get(l_id);
+        if (l->x < lo)
+            l_id = l->right;
+        else
+        {
+            left = combine(combine(lift(l), sub(l->right)), left);
+            l_id = l->left;
+        }
     }
-    if (v->right != -1)
+    for (Index r_id = v->right; r_id != NIL; )
     {
-        Node* tr = pool.get(v->right);
-        v->size += tr->size;
-        tr->parent = id;
+        Node *r = pool.get(r_id);
+        if (hi < r->x)
+            r_id = r->left;
+        else
+        {
+            right = combine(right, combine(sub(r->left), lift(r)));
+            r_id = r->right;
+        }
     }
+    return combine(combine(left, lift(v)), right);
 }
 
-template<typename Key, typename Data>
-size_t Treap<Key, Data>::min_vert(size_t v_id) const
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+Index Treap<Key, Data, Index, Priority, Aggregate>::min_vert(Index v_id) const
 {
-    if (v_id == -1)
-        return -1;
+    if (v_id == NIL)
+        return NIL;
     Node *v;
-    while ((v = pool.get(v_id))->left != -1) 
+    while ((v = pool.get(v_id))->left != NIL) 
         v_id = v->left;
     return v_id;
 }
 
-template<typename Key, typename Data>
-void Treap<Key, Data>::print(std::ostream &out, size_t id) const
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+void Treap<Key, Data, Index, Priority, Aggregate>::print(std::ostream &out, Index id) const
 {
     TREAP_CHECK(id);
-    if (id == -1) return;
+    if (id == NIL) return;
     Node *v = pool.get(id);
     print(out, v->left);
         
@@ -708,13 +1622,13 @@ void Treap<Key, Data>::print(std::ostream &out, size_t id) const
     print(out, v->right);
 } 
 
-template<typename Key, typename Data>
-size_t Treap<Key, Data>::max_vert(size_t v_id) const
+template<typename Key, typename Data, typename Index, class Priority, class Aggregate>
+Index Treap<Key, Data, Index, Priority, Aggregate>::max_vert(Index v_id) const
 {
-    if (v_id == -1)
-        return -1;
+    if (v_id == NIL)
+        return NIL;
     Node *v;
-    while ((v = pool.get(v_id))->right != -1)
+    while ((v = pool.get(v_id))->right != NIL)
         v_id = v->right;
     return v_id;
 }